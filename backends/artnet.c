@@ -10,11 +10,16 @@
 #define MAX_FDS 255
 
 static struct {
-	uint32_t next_frame;
 	uint8_t default_net;
 	size_t fds;
 	artnet_descriptor* fd;
+	mmbackend_recv_batch batch;
+	uint64_t flush_timer;
+	uint8_t flush_armed;
 	uint8_t detect;
+	uint8_t sync;
+	uint64_t last_sync;
+	artnet_sync sync_frame;
 } global_cfg = {
 	0
 };
@@ -59,6 +64,8 @@ static int artnet_listener(char* host, char* port, struct sockaddr_storage* anno
 	global_cfg.fd[global_cfg.fds].fd = fd;
 	global_cfg.fd[global_cfg.fds].output_instances = 0;
 	global_cfg.fd[global_cfg.fds].output_instance = NULL;
+	global_cfg.fd[global_cfg.fds].queued = NULL;
+	memset(&global_cfg.fd[global_cfg.fds].batch, 0, sizeof(global_cfg.fd[global_cfg.fds].batch));
 	memcpy(&global_cfg.fd[global_cfg.fds].announce_addr, announce, sizeof(global_cfg.fd[global_cfg.fds].announce_addr));
 	global_cfg.fds++;
 	return 0;
@@ -71,10 +78,10 @@ MM_PLUGIN_API int init(){
 		.create = artnet_instance,
 		.conf_instance = artnet_configure_instance,
 		.channel = artnet_channel,
+		.channel_range = artnet_channel_range,
 		.handle = artnet_set,
 		.process = artnet_handle,
 		.start = artnet_start,
-		.interval = artnet_interval,
 		.shutdown = artnet_shutdown
 	};
 
@@ -91,13 +98,6 @@ MM_PLUGIN_API int init(){
 	return 0;
 }
 
-static uint32_t artnet_interval(){
-	if(global_cfg.next_frame){
-		return global_cfg.next_frame;
-	}
-	return ARTNET_KEEPALIVE_INTERVAL;
-}
-
 static int artnet_configure(char* option, char* value){
 	char* host = NULL, *port = NULL, *fd_opts = NULL;
 	struct sockaddr_storage announce = {0};
@@ -140,6 +140,13 @@ static int artnet_configure(char* option, char* value){
 		}
 		return 0;
 	}
+	else if(!strcmp(option, "sync")){
+		global_cfg.sync = 0;
+		if(!strcmp(value, "on")){
+			global_cfg.sync = 1;
+		}
+		return 0;
+	}
 
 	LOGPF("Unknown backend option %s", option);
 	return 1;
@@ -155,6 +162,8 @@ static int artnet_instance(instance* inst){
 	}
 
 	data->net = global_cfg.default_net;
+	data->data.out = data->data.frame.data;
+	data->data.merge.timeout = ARTNET_SOURCE_TIMEOUT;
 	for(u = 0; u < sizeof(data->data.channel) / sizeof(channel); u++){
 		data->data.channel[u].ident = u;
 		data->data.channel[u].instance = inst;
@@ -199,6 +208,19 @@ static int artnet_configure_instance(instance* inst, char* option, char* value){
 		data->realtime = strtoul(value, NULL, 10);
 		return 0;
 	}
+	else if(!strcmp(option, "merge")){
+		if(!strcmp(value, "htp")){
+			data->data.merge.mode = merge_htp;
+		}
+		else if(!strcmp(value, "ltp")){
+			data->data.merge.mode = merge_ltp;
+		}
+		else{
+			LOGPF("Unknown merge mode %s on instance %s", value, inst->name);
+			return 1;
+		}
+		return 0;
+	}
 
 	LOGPF("Unknown instance option %s for instance %s", option, inst->name);
 	return 1;
@@ -253,43 +275,130 @@ static channel* artnet_channel(instance* inst, char* spec, uint8_t flags){
 	return data->data.channel + chan_a;
 }
 
-static int artnet_transmit(instance* inst, artnet_output_universe* output){
+static int artnet_channel_range(instance* inst, char* prefix, uint64_t first, uint64_t last, char* suffix, uint8_t flags, channel** channels){
 	artnet_instance_data* data = (artnet_instance_data*) inst->impl;
+	uint64_t u, chan;
 
-	//build output frame
-	artnet_dmx frame = {
-		.magic = {'A', 'r', 't', '-', 'N', 'e', 't', 0x00},
-		.opcode = htobe16(OpDmx),
-		.version = htobe16(ARTNET_VERSION),
-		.sequence = data->data.seq++,
-		.port = 0,
-		.universe = data->uni,
-		.net = data->net,
-		.length = htobe16(512),
-		.data = {0}
-	};
-	memcpy(frame.data, data->data.out, 512);
-
-	if(sendto(global_cfg.fd[data->fd_index].fd, (uint8_t*) &frame, sizeof(frame), 0, (struct sockaddr*) &data->dest_addr, data->dest_len) < 0){
-		#ifdef _WIN32
-		if(WSAGetLastError() != WSAEWOULDBLOCK){
-		#else
-		if(errno != EAGAIN){
-		#endif
-			LOGPF("Failed to output frame for instance %s: %s", inst->name, mmbackend_socket_strerror(errno));
+	//only plain channel ranges are handled here, everything else is parsed per channel
+	if(*prefix || *suffix
+			|| !first || first > 512
+			|| !last || last > 512){
+		return 1;
+	}
+
+	//check output capabilities
+	if((flags & mmchannel_output) && !data->dest_len){
+		LOGPF("Channels %s.{%" PRIu64 "..%" PRIu64 "} mapped for output, but instance is not configured for output (missing destination)", inst->name, first, last);
+	}
+
+	for(u = 0; u <= max(first, last) - min(first, last); u++){
+		chan = ((first <= last) ? (first + u) : (first - u)) - 1;
+
+		//let the per-channel parser report mapping conflicts
+		if(IS_ACTIVE(data->data.map[chan]) && data->data.map[chan] != (MAP_SINGLE | chan)){
 			return 1;
 		}
-		//reschedule frame output
-		output->mark = 1;
-		if(!global_cfg.next_frame || global_cfg.next_frame > ARTNET_SYNTHESIZE_MARGIN){
-			global_cfg.next_frame = ARTNET_SYNTHESIZE_MARGIN;
-		}
+
+		data->data.map[chan] = MAP_SINGLE | chan;
+		channels[u] = data->data.channel + chan;
+	}
+	return 0;
+}
+
+static int artnet_transmit(instance* inst, artnet_output_universe* output){
+	artnet_instance_data* data = (artnet_instance_data*) inst->impl;
+	artnet_descriptor* fd = global_cfg.fd + data->fd_index;
+	uint32_t frame_delta = 0;
+
+	//schedule next keepalive frame
+	mm_timer_update(output->timer, ARTNET_KEEPALIVE_INTERVAL);
+
+	//a queued frame is read on flush and already contains any later changes
+	if(output->queued){
 		return 0;
 	}
 
-	//update last frame timestamp
-	output->last_frame = mm_timestamp();
-	output->mark = 0;
+	//the batch has a slot for every output universe on the socket
+	data->data.frame.sequence = data->data.seq++;
+	fd->queued[fd->batch.pending] = output;
+	mmbackend_send_queue(&fd->batch, (uint8_t*) &data->data.frame, sizeof(artnet_dmx), (struct sockaddr*) &data->dest_addr, data->dest_len);
+	output->queued = 1;
+
+	//send all frames queued in this iteration together at the start of the next one
+	if(!global_cfg.flush_armed){
+		global_cfg.flush_armed = 1;
+		//synchronized output is rate limited as a whole
+		frame_delta = mm_timestamp() - global_cfg.last_sync;
+		mm_timer_update(global_cfg.flush_timer, (global_cfg.sync && frame_delta < ARTNET_FRAME_TIMEOUT) ? (ARTNET_FRAME_TIMEOUT - frame_delta) : 0);
+	}
+	return 0;
+}
+
+static void artnet_queue_sync(artnet_descriptor* fd){
+	size_t p, d, queued = fd->batch.pending;
+	artnet_instance_data* data = NULL;
+
+	//follow the frames with one ArtSync per distinct destination
+	for(p = 0; p < queued; p++){
+		data = (artnet_instance_data*) fd->queued[p]->inst->impl;
+		for(d = queued; d < fd->batch.pending; d++){
+			if(fd->batch.dest_len[d] == data->dest_len && !memcmp(fd->batch.dest[d], &data->dest_addr, data->dest_len)){
+				break;
+			}
+		}
+
+		if(d == fd->batch.pending){
+			mmbackend_send_queue(&fd->batch, (uint8_t*) &global_cfg.sync_frame, sizeof(artnet_sync), (struct sockaddr*) &data->dest_addr, data->dest_len);
+		}
+	}
+}
+
+static int artnet_flush(uint64_t timer, void* impl){
+	size_t u, p, queued, total, sent;
+	artnet_descriptor* fd = NULL;
+
+	global_cfg.flush_armed = 0;
+	for(u = 0; u < global_cfg.fds; u++){
+		fd = global_cfg.fd + u;
+		if(!fd->batch.pending){
+			continue;
+		}
+
+		queued = fd->batch.pending;
+		if(global_cfg.sync){
+			artnet_queue_sync(fd);
+		}
+
+		total = fd->batch.pending;
+		sent = mmbackend_send_flush(&fd->batch, fd->fd);
+		if(sent < total){
+			#ifdef _WIN32
+			if(WSAGetLastError() != WSAEWOULDBLOCK){
+			#else
+			if(errno != EAGAIN){
+			#endif
+				LOGPF("Failed to output %" PRIsize_t " frames on socket %" PRIsize_t ": %s", total - sent, u, mmbackend_socket_strerror(errno));
+			}
+		}
+
+		for(p = 0; p < queued; p++){
+			fd->queued[p]->queued = 0;
+			if(p < sent){
+				//update last frame timestamp
+				fd->queued[p]->last_frame = mm_timestamp();
+				fd->queued[p]->mark = 0;
+			}
+			else{
+				//reschedule frame output
+				fd->queued[p]->mark = 1;
+				mm_timer_update(fd->queued[p]->timer, ARTNET_SYNTHESIZE_MARGIN);
+			}
+		}
+	}
+
+	if(global_cfg.sync){
+		global_cfg.last_sync = mm_timestamp();
+	}
 	return 0;
 }
 
@@ -332,14 +441,15 @@ static int artnet_set(instance* inst, size_t num, channel** c, channel_value* v)
 			}
 		}
 
-		if(!data->realtime){
+		//synchronized output is rate limited per frame across all universes when flushing
+		if(!data->realtime && !global_cfg.sync){
 			frame_delta = mm_timestamp() - global_cfg.fd[data->fd_index].output_instance[u].last_frame;
 
-			//check output rate limit, request next frame
+			//check output rate limit, schedule next frame
 			if(frame_delta < ARTNET_FRAME_TIMEOUT){
-				global_cfg.fd[data->fd_index].output_instance[u].mark = 1;
-				if(!global_cfg.next_frame || global_cfg.next_frame > (ARTNET_FRAME_TIMEOUT - frame_delta)){
-					global_cfg.next_frame = (ARTNET_FRAME_TIMEOUT - frame_delta);
+				if(!global_cfg.fd[data->fd_index].output_instance[u].mark){
+					global_cfg.fd[data->fd_index].output_instance[u].mark = 1;
+					mm_timer_update(global_cfg.fd[data->fd_index].output_instance[u].timer, ARTNET_FRAME_TIMEOUT - frame_delta);
 				}
 				return 0;
 			}
@@ -350,12 +460,16 @@ static int artnet_set(instance* inst, size_t num, channel** c, channel_value* v)
 	return 0;
 }
 
-static inline int artnet_process_dmx(instance* inst, artnet_dmx* frame){
-	size_t p, max_mark = 0;
+static inline int artnet_process_dmx(instance* inst, artnet_dmx* frame, struct sockaddr_storage* source){
+	size_t p, w, partner;
+	uint64_t changed[MMBACKEND_DIFF_WORDS];
 	uint16_t wide_val = 0;
 	channel* chan = NULL;
-	channel_value val;
+	channel_value val = {0};
 	artnet_instance_data* data = (artnet_instance_data*) inst->impl;
+	//sources are identified by their address, ignoring the port
+	uint8_t* source_id = (source->ss_family == AF_INET6) ? (uint8_t*) &((struct sockaddr_in6*) source)->sin6_addr : (uint8_t*) &((struct sockaddr_in*) source)->sin_addr;
+	size_t source_len = (source->ss_family == AF_INET6) ? sizeof(struct in6_addr) : sizeof(struct in_addr);
 
 	if(!data->last_input && global_cfg.detect){
 		LOGPF("Valid data on instance %s (Net %d Universe %d): %d channels", inst->name, data->net, data->uni, be16toh(frame->length));
@@ -367,28 +481,37 @@ static inline int artnet_process_dmx(instance* inst, artnet_dmx* frame){
 		return 1;
 	}
 
-	//read data, mark update channels
-	for(p = 0; p < be16toh(frame->length); p++){
-		if(IS_ACTIVE(data->data.map[p]) && frame->data[p] != data->data.in[p]){
-			data->data.in[p] = frame->data[p];
-			data->data.map[p] |= MAP_MARK;
-			max_mark = p;
+	//Art-Net carries no priorities, all sources are merged by merge mode only
+	if(mmbackend_merge_update(&data->data.merge, source_id, source_len, 0, frame->data, be16toh(frame->length), data->last_input)){
+		if(global_cfg.detect > 1){
+			LOGPF("Source limit reached on instance %s, ignoring data", inst->name);
 		}
+		return 0;
 	}
 
+	//only channels whose merged value changed generate events
+	if(!mmbackend_diff(data->data.in, data->data.merge.merged, data->data.active, changed)){
+		return 0;
+	}
+	memcpy(data->data.in, data->data.merge.merged, sizeof(data->data.in));
+
 	//generate events
-	for(p = 0; p <= max_mark; p++){
-		if(data->data.map[p] & MAP_MARK){
-			data->data.map[p] &= ~MAP_MARK;
+	for(w = 0; w < MMBACKEND_DIFF_WORDS; w++){
+		while(changed[w]){
+			p = w * 64 + __builtin_ctzll(changed[w]);
+			changed[w] &= changed[w] - 1;
+
 			chan = data->data.channel + p;
 			if(data->data.map[p] & MAP_FINE){
 				chan = data->data.channel + MAPPED_CHANNEL(data->data.map[p]);
 			}
 
 			if(IS_WIDE(data->data.map[p])){
-				data->data.map[MAPPED_CHANNEL(data->data.map[p])] &= ~MAP_MARK;
+				//the event covers both halves of a wide channel
+				partner = MAPPED_CHANNEL(data->data.map[p]);
+				changed[partner / 64] &= ~(((uint64_t) 1) << (partner % 64));
 				wide_val = data->data.in[p] << ((data->data.map[p] & MAP_COARSE) ? 8 : 0);
-				wide_val |= data->data.in[MAPPED_CHANNEL(data->data.map[p])] << ((data->data.map[p] & MAP_COARSE) ? 0 : 8);
+				wide_val |= data->data.in[partner] << ((data->data.map[p] & MAP_COARSE) ? 0 : 8);
 
 				val.raw.u64 = wide_val;
 				val.normalised = (double) wide_val / (double) 0xFFFF;
@@ -494,64 +617,42 @@ static int artnet_process_poll(uint8_t fd, struct sockaddr* source, socklen_t so
 	return 0;
 }
 
-static int artnet_maintenance(){
-	size_t u, c;
-	uint64_t timestamp = mm_timestamp();
-	uint32_t synthesize_delta = 0;
-	instance* inst = NULL;
+static int artnet_output_timer(uint64_t timer, void* impl){
+	artnet_output_universe* output = (artnet_output_universe*) impl;
 
-	//transmit keepalive & synthesized frames
-	global_cfg.next_frame = 0;
-	for(u = 0; u < global_cfg.fds; u++){
-		for(c = 0; c < global_cfg.fd[u].output_instances; c++){
-			synthesize_delta = timestamp - global_cfg.fd[u].output_instance[c].last_frame;
-			if((global_cfg.fd[u].output_instance[c].mark
-						&& synthesize_delta >= ARTNET_FRAME_TIMEOUT + ARTNET_SYNTHESIZE_MARGIN) //synthesize next frame
-					|| synthesize_delta >= ARTNET_KEEPALIVE_INTERVAL){ //keepalive timeout
-				inst = mm_instance_find(BACKEND_NAME, global_cfg.fd[u].output_instance[c].label);
-				if(inst){
-					artnet_transmit(inst, global_cfg.fd[u].output_instance + c);
-				}
-			}
-
-			//update next_frame
-			if(global_cfg.fd[u].output_instance[c].mark
-					&& (!global_cfg.next_frame || global_cfg.next_frame > ARTNET_FRAME_TIMEOUT + ARTNET_SYNTHESIZE_MARGIN - synthesize_delta)){
-				global_cfg.next_frame = ARTNET_FRAME_TIMEOUT + ARTNET_SYNTHESIZE_MARGIN - synthesize_delta;
-			}
-		}
-	}
+	//keepalive or rate-limited frame due, transmission failures are not fatal here
+	artnet_transmit(output->inst, output);
 	return 0;
 }
 
 static int artnet_handle(size_t num, managed_fd* fds){
-	size_t u;
-	struct sockaddr_storage peer_addr;
-	socklen_t peer_len = sizeof(peer_addr);
-	ssize_t bytes_read;
-	char recv_buf[ARTNET_RECV_BUF];
+	size_t u, bytes_read;
+	ssize_t packets, p;
 	artnet_instance_id inst_id = {
 		.label = 0
 	};
 	instance* inst = NULL;
-	artnet_dmx* frame = (artnet_dmx*) recv_buf;
-
-	if(artnet_maintenance()){
-		return 1;
-	}
+	artnet_dmx* frame = NULL;
 
 	for(u = 0; u < num; u++){
+		//a full batch indicates that more packets may be pending
 		do{
-			bytes_read = recvfrom(fds[u].fd, recv_buf, sizeof(recv_buf), 0, (struct sockaddr*) &peer_addr, &peer_len);
-			if(bytes_read > 0 && bytes_read > sizeof(artnet_hdr) && !memcmp(frame->magic, "Art-Net\0", 8)){
+			packets = mmbackend_recv(&global_cfg.batch, fds[u].fd);
+			for(p = 0; p < packets; p++){
+				frame = (artnet_dmx*) (global_cfg.batch.buffer + p * global_cfg.batch.size);
+				bytes_read = global_cfg.batch.length[p];
+				if(bytes_read <= sizeof(artnet_hdr) || memcmp(frame->magic, "Art-Net\0", 8)){
+					continue;
+				}
+
 				//DBGPF("Frame with opcode %04X, size %" PRIsize_t " on socket %" PRIu64, be16toh(frame->opcode), bytes_read, ((uint64_t) fds[u].impl) & 0xFF);
 				if(be16toh(frame->opcode) == OpDmx && bytes_read >= (sizeof(artnet_dmx) - 512)){
 					//find matching instance
 					inst_id.fields.fd_index = ((uint64_t) fds[u].impl) & 0xFF;
 					inst_id.fields.net = frame->net;
 					inst_id.fields.uni = frame->universe;
-					inst = mm_instance_find(BACKEND_NAME, inst_id.label);
-					if(inst && artnet_process_dmx(inst, frame)){
+					inst = mm_instance_lookup(fds[u].backend, inst_id.label);
+					if(inst && artnet_process_dmx(inst, frame, global_cfg.batch.peer + p)){
 						LOG("Failed to process DMX frame");
 					}
 					else if(!inst && global_cfg.detect > 1){
@@ -559,25 +660,16 @@ static int artnet_handle(size_t num, managed_fd* fds){
 					}
 				}
 				else if(be16toh(frame->opcode) == OpPoll && bytes_read >= sizeof(artnet_poll)){
-					if(artnet_process_poll(((uint64_t) fds[u].impl) & 0xFF, (struct sockaddr*) &peer_addr, peer_len)){
+					if(artnet_process_poll(((uint64_t) fds[u].impl) & 0xFF, (struct sockaddr*) (global_cfg.batch.peer + p), global_cfg.batch.peer_len[p])){
 						LOG("Failed to process discovery frame");
 					}
 				}
 			}
-		} while(bytes_read > 0);
+		} while(packets == global_cfg.batch.slots);
 
-		#ifdef _WIN32
-		if(bytes_read < 0 && WSAGetLastError() != WSAEWOULDBLOCK){
-		#else
-		if(bytes_read < 0 && errno != EAGAIN){
-		#endif
+		if(packets < 0){
 			LOGPF("Failed to receive data: %s", mmbackend_socket_strerror(errno));
 		}
-
-		if(bytes_read == 0){
-			LOG("Listener closed");
-			return 1;
-		}
 	}
 
 	return 0;
@@ -596,6 +688,14 @@ static int artnet_start(size_t n, instance** inst){
 		return 1;
 	}
 
+	if(mmbackend_recv_init(&global_cfg.batch, ARTNET_RECV_BATCH, ARTNET_RECV_BUF)){
+		return 1;
+	}
+
+	memcpy(global_cfg.sync_frame.magic, "Art-Net\0", 8);
+	global_cfg.sync_frame.opcode = htobe16(OpSync);
+	global_cfg.sync_frame.version = htobe16(ARTNET_VERSION);
+
 	for(u = 0; u < n; u++){
 		data = (artnet_instance_data*) inst[u]->impl;
 		//set instance identifier
@@ -604,6 +704,20 @@ static int artnet_start(size_t n, instance** inst){
 		id.fields.uni = data->uni;
 		inst[u]->ident = id.label;
 
+		//precompute the input slot mask
+		for(p = 0; p < sizeof(data->data.active); p++){
+			data->data.active[p] = IS_ACTIVE(data->data.map[p]) ? 0xFF : 0;
+		}
+
+		//prepare the static parts of the output frame
+		memcpy(data->data.frame.magic, "Art-Net\0", 8);
+		data->data.frame.opcode = htobe16(OpDmx);
+		data->data.frame.version = htobe16(ARTNET_VERSION);
+		data->data.frame.port = 0;
+		data->data.frame.universe = data->uni;
+		data->data.frame.net = data->net;
+		data->data.frame.length = htobe16(512);
+
 		//check for duplicates
 		for(p = 0; p < u; p++){
 			if(inst[u]->ident == inst[p]->ident){
@@ -621,8 +735,11 @@ static int artnet_start(size_t n, instance** inst){
 				goto bail;
 			}
 			global_cfg.fd[data->fd_index].output_instance[global_cfg.fd[data->fd_index].output_instances].label = id.label;
+			global_cfg.fd[data->fd_index].output_instance[global_cfg.fd[data->fd_index].output_instances].inst = inst[u];
+			global_cfg.fd[data->fd_index].output_instance[global_cfg.fd[data->fd_index].output_instances].timer = 0;
 			global_cfg.fd[data->fd_index].output_instance[global_cfg.fd[data->fd_index].output_instances].last_frame = 0;
 			global_cfg.fd[data->fd_index].output_instance[global_cfg.fd[data->fd_index].output_instances].mark = 0;
+			global_cfg.fd[data->fd_index].output_instance[global_cfg.fd[data->fd_index].output_instances].queued = 0;
 
 			global_cfg.fd[data->fd_index].output_instances++;
 		}
@@ -633,6 +750,33 @@ static int artnet_start(size_t n, instance** inst){
 		if(mm_manage_fd(global_cfg.fd[u].fd, BACKEND_NAME, 1, (void*) u)){
 			goto bail;
 		}
+
+		if(global_cfg.fd[u].output_instances){
+			global_cfg.fd[u].queued = calloc(global_cfg.fd[u].output_instances, sizeof(artnet_output_universe*));
+			if(!global_cfg.fd[u].queued){
+				LOG("Failed to allocate memory");
+				goto bail;
+			}
+
+			//in synchronized mode, each frame may be followed by an ArtSync to a separate destination
+			if(mmbackend_send_init(&global_cfg.fd[u].batch, global_cfg.fd[u].output_instances * (global_cfg.sync ? 2 : 1))){
+				goto bail;
+			}
+		}
+
+		//start output timers, the first frame is sent immediately
+		for(p = 0; p < global_cfg.fd[u].output_instances; p++){
+			global_cfg.fd[u].output_instance[p].timer = mm_timer_add(BACKEND_NAME, 0, 0, artnet_output_timer, global_cfg.fd[u].output_instance + p);
+			if(!global_cfg.fd[u].output_instance[p].timer){
+				goto bail;
+			}
+		}
+	}
+
+	//frames queued during an iteration are sent by a timer firing at the start of the next one
+	global_cfg.flush_timer = mm_timer_add(BACKEND_NAME, 0, 0, artnet_flush, NULL);
+	if(!global_cfg.flush_timer){
+		goto bail;
 	}
 
 	rv = 0;
@@ -641,20 +785,47 @@ bail:
 }
 
 static int artnet_shutdown(size_t n, instance** inst){
-	size_t p;
+	size_t p, u;
+	uint64_t packets = 0, calls = 0;
 
 	for(p = 0; p < n; p++){
+		mmbackend_merge_free(&((artnet_instance_data*) inst[p]->impl)->data.merge);
 		free(inst[p]->impl);
 	}
 
+	if(global_cfg.flush_timer){
+		mm_timer_cancel(global_cfg.flush_timer);
+	}
+	global_cfg.flush_timer = 0;
+	global_cfg.flush_armed = 0;
+	global_cfg.last_sync = 0;
+
 	for(p = 0; p < global_cfg.fds; p++){
 		close(global_cfg.fd[p].fd);
+		for(u = 0; u < global_cfg.fd[p].output_instances; u++){
+			mm_timer_cancel(global_cfg.fd[p].output_instance[u].timer);
+		}
 		free(global_cfg.fd[p].output_instance);
+
+		packets += global_cfg.fd[p].batch.packets;
+		calls += global_cfg.fd[p].batch.calls;
+		mmbackend_send_free(&global_cfg.fd[p].batch);
+		free(global_cfg.fd[p].queued);
+	}
+
+	if(calls){
+		LOGPF("Sent %" PRIu64 " frames in %" PRIu64 " transmit calls", packets, calls);
 	}
 	free(global_cfg.fd);
 	global_cfg.fd = NULL;
 	global_cfg.fds = 0;
 
+	if(global_cfg.batch.calls){
+		LOGPF("Received %" PRIu64 " packets in %" PRIu64 " receive calls", global_cfg.batch.packets, global_cfg.batch.calls);
+	}
+	mmbackend_recv_free(&global_cfg.batch);
+	global_cfg.batch.calls = global_cfg.batch.packets = 0;
+
 	LOG("Backend shut down");
 	return 0;
 }
@@ -4,11 +4,11 @@
 #include "midimonster.h"
 
 MM_PLUGIN_API int init();
-static uint32_t artnet_interval();
 static int artnet_configure(char* option, char* value);
 static int artnet_configure_instance(instance* instance, char* option, char* value);
 static int artnet_instance(instance* inst);
 static channel* artnet_channel(instance* instance, char* spec, uint8_t flags);
+static int artnet_channel_range(instance* instance, char* prefix, uint64_t first, uint64_t last, char* suffix, uint8_t flags, channel** channels);
 static int artnet_set(instance* inst, size_t num, channel** c, channel_value* v);
 static int artnet_handle(size_t num, managed_fd* fds);
 static int artnet_start(size_t n, instance** inst);
@@ -19,62 +19,24 @@ static int artnet_shutdown(size_t n, instance** inst);
 #define ARTNET_ESTA_MANUFACTURER 0x4653 //"FS" as registered with ESTA
 #define ARTNET_OEM 0x2B93 //as registered with artistic license
 #define ARTNET_RECV_BUF 4096
+//number of packets received per system call
+#define ARTNET_RECV_BATCH 32
 
 #define ARTNET_KEEPALIVE_INTERVAL 1000
 //limit transmit rate to at most 44 packets per second (1000/44 ~= 22)
 #define ARTNET_FRAME_TIMEOUT 20
 #define ARTNET_SYNTHESIZE_MARGIN 10
+//merge sources are dropped after 10 seconds without data
+#define ARTNET_SOURCE_TIMEOUT 10000
 
 #define MAP_COARSE 0x0200
 #define MAP_FINE 0x0400
 #define MAP_SINGLE 0x0800
-#define MAP_MARK 0x1000
 #define MAPPED_CHANNEL(a) ((a) & 0x01FF)
 #define IS_ACTIVE(a) ((a) & 0xFE00)
 #define IS_WIDE(a) ((a) & (MAP_FINE | MAP_COARSE))
 #define IS_SINGLE(a) ((a) & MAP_SINGLE)
 
-typedef struct /*_artnet_universe_model*/ {
-	uint8_t seq;
-	uint8_t in[512];
-	uint8_t out[512];
-	uint16_t map[512];
-	channel channel[512];
-} artnet_universe;
-
-typedef struct /*_artnet_instance_model*/ {
-	uint8_t net;
-	uint8_t uni;
-	struct sockaddr_storage dest_addr;
-	socklen_t dest_len;
-	artnet_universe data;
-	size_t fd_index;
-	uint64_t last_input;
-	uint8_t realtime;
-} artnet_instance_data;
-
-typedef union /*_artnet_instance_id*/ {
-	struct {
-		uint8_t fd_index;
-		uint8_t net;
-		uint8_t uni;
-	} fields;
-	uint64_t label;
-} artnet_instance_id;
-
-typedef struct /*_artnet_fd_universe*/ {
-	uint64_t label;
-	uint64_t last_frame;
-	uint8_t mark;
-} artnet_output_universe;
-
-typedef struct /*_artnet_fd*/ {
-	int fd;
-	size_t output_instances;
-	artnet_output_universe* output_instance;
-	struct sockaddr_storage announce_addr; //used for pollreplies if ss_family == AF_INET, port is always valid
-} artnet_descriptor;
-
 #pragma pack(push, 1)
 typedef struct /*_artnet_hdr*/ {
 	uint8_t magic[8];
@@ -94,6 +56,13 @@ typedef struct /*_artnet_dmx*/ {
 	uint8_t data[512];
 } artnet_dmx;
 
+typedef struct /*_artnet_sync*/ {
+	uint8_t magic[8];
+	uint16_t opcode;
+	uint16_t version;
+	uint8_t aux[2];
+} artnet_sync;
+
 typedef struct /*_artnet_poll*/ {
 	uint8_t magic[8];
 	uint16_t opcode;
@@ -137,8 +106,62 @@ typedef struct /*_artnet_poll_reply*/ {
 } artnet_poll_reply;
 #pragma pack(pop)
 
+typedef struct /*_artnet_universe_model*/ {
+	uint8_t seq;
+	//input sources, identified by their address and merged by merge mode
+	mmbackend_merge merge;
+	uint8_t in[512];
+	//0xFF for each mapped input slot, used to diff incoming frames
+	uint8_t active[512];
+	//persistent output frame, only the sequence number and channel data are updated per transmission
+	artnet_dmx frame;
+	uint8_t* out;
+	uint16_t map[512];
+	channel channel[512];
+} artnet_universe;
+
+typedef struct /*_artnet_instance_model*/ {
+	uint8_t net;
+	uint8_t uni;
+	struct sockaddr_storage dest_addr;
+	socklen_t dest_len;
+	artnet_universe data;
+	size_t fd_index;
+	uint64_t last_input;
+	uint8_t realtime;
+} artnet_instance_data;
+
+typedef union /*_artnet_instance_id*/ {
+	struct {
+		uint8_t fd_index;
+		uint8_t net;
+		uint8_t uni;
+	} fields;
+	uint64_t label;
+} artnet_instance_id;
+
+typedef struct /*_artnet_fd_universe*/ {
+	uint64_t label;
+	instance* inst;
+	uint64_t timer;
+	uint64_t last_frame;
+	uint8_t mark;
+	uint8_t queued;
+} artnet_output_universe;
+
+typedef struct /*_artnet_fd*/ {
+	int fd;
+	size_t output_instances;
+	artnet_output_universe* output_instance;
+	//frames due for transmission, sent together by the flush timer
+	mmbackend_send_batch batch;
+	artnet_output_universe** queued;
+	struct sockaddr_storage announce_addr; //used for pollreplies if ss_family == AF_INET, port is always valid
+} artnet_descriptor;
+
 enum artnet_pkt_opcode {
 	OpPoll = 0x0020,
 	OpPollReply = 0x0021,
-	OpDmx = 0x0050
+	OpDmx = 0x0050,
+	OpSync = 0x0052
 };
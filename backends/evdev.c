@@ -34,7 +34,8 @@ MM_PLUGIN_API int init(){
 		.handle = evdev_set,
 		.process = evdev_handle,
 		.start = evdev_start,
-		.shutdown = evdev_shutdown
+		.shutdown = evdev_shutdown,
+		.flags = mmbackend_no_echo
 	};
 
 	if(sizeof(evdev_channel_ident) != sizeof(uint64_t)){
@@ -304,7 +305,7 @@ static channel* evdev_channel(instance* inst, char* spec, uint8_t flags){
 
 static int evdev_push_event(instance* inst, evdev_instance_data* data, struct input_event event){
 	uint64_t range = 0;
-	channel_value val;
+	channel_value val = {0};
 	evdev_channel_ident ident = {
 		.fields.type = event.type,
 		.fields.code = event.code
@@ -0,0 +1,372 @@
+#define BACKEND_NAME "generator"
+
+#include <string.h>
+#include <time.h>
+#include "generator.h"
+
+MM_PLUGIN_API int init(){
+	backend generator = {
+		.name = BACKEND_NAME,
+		.conf = generator_configure,
+		.create = generator_instance,
+		.conf_instance = generator_configure_instance,
+		.channel = generator_channel,
+		.handle = generator_set,
+		.process = generator_handle,
+		.start = generator_start,
+		.shutdown = generator_shutdown,
+		.flags = mmbackend_no_echo
+	};
+
+	//register backend
+	if(mm_backend_register(generator)){
+		LOG("Failed to register backend");
+		return 1;
+	}
+	return 0;
+}
+
+static uint64_t generator_clock(){
+	#ifdef _WIN32
+	LARGE_INTEGER count, frequency;
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&frequency);
+	return (count.QuadPart / frequency.QuadPart) * 1000000000 + ((count.QuadPart % frequency.QuadPart) * 1000000000) / frequency.QuadPart;
+	#else
+	struct timespec current;
+	clock_gettime(CLOCK_MONOTONIC, &current);
+	return ((uint64_t) current.tv_sec) * 1000000000 + current.tv_nsec;
+	#endif
+}
+
+//xorshift64*, seeded per instance to make random patterns reproducible
+static double generator_random(generator_instance_data* data){
+	data->seed ^= data->seed >> 12;
+	data->seed ^= data->seed << 25;
+	data->seed ^= data->seed >> 27;
+	return ((data->seed * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static int generator_configure(char* option, char* value){
+	//no global configuration
+	LOG("No backend configuration possible");
+	return 1;
+}
+
+static int generator_configure_instance(instance* inst, char* option, char* value){
+	generator_instance_data* data = (generator_instance_data*) inst->impl;
+
+	if(!strcmp(option, "pattern")){
+		if(!strcmp(value, "ramp")){
+			data->pattern = pattern_ramp;
+		}
+		else if(!strcmp(value, "random")){
+			data->pattern = pattern_random;
+		}
+		else if(!strcmp(value, "toggle")){
+			data->pattern = pattern_toggle;
+		}
+		else if(!strcmp(value, "constant")){
+			data->pattern = pattern_constant;
+		}
+		else{
+			LOGPF("Unknown pattern %s for instance %s", value, inst->name);
+			return 1;
+		}
+		return 0;
+	}
+	else if(!strcmp(option, "step")){
+		data->step = clamp(strtod(value, NULL), 1.0, 0.0);
+		return 0;
+	}
+	else if(!strcmp(option, "value")){
+		data->value = clamp(strtod(value, NULL), 1.0, 0.0);
+		return 0;
+	}
+	else if(!strcmp(option, "rate")){
+		data->rate = strtoul(value, NULL, 10);
+		return 0;
+	}
+	else if(!strcmp(option, "burst")){
+		data->burst = strtoul(value, NULL, 10);
+		if(!data->burst){
+			LOGPF("Invalid burst size for instance %s", inst->name);
+			return 1;
+		}
+		return 0;
+	}
+	else if(!strcmp(option, "interval")){
+		data->interval = strtoul(value, NULL, 10);
+		if(!data->interval){
+			LOGPF("Invalid generation interval for instance %s", inst->name);
+			return 1;
+		}
+		return 0;
+	}
+	else if(!strcmp(option, "limit")){
+		data->limit = strtoul(value, NULL, 10);
+		return 0;
+	}
+	else if(!strcmp(option, "seed")){
+		//the generator state must never be zero
+		data->seed = strtoul(value, NULL, 10);
+		data->seed = data->seed ? data->seed : 1;
+		return 0;
+	}
+	else if(!strcmp(option, "source")){
+		free(data->source_name);
+		data->source_name = strdup(value);
+		if(!data->source_name){
+			LOG("Failed to allocate memory");
+			return 1;
+		}
+		return 0;
+	}
+
+	LOGPF("Unknown instance configuration parameter %s for instance %s", option, inst->name);
+	return 1;
+}
+
+static int generator_instance(instance* inst){
+	generator_instance_data* data = calloc(1, sizeof(generator_instance_data));
+	if(!data){
+		LOG("Failed to allocate memory");
+		return 1;
+	}
+
+	data->step = 0.01;
+	data->rate = 1000;
+	data->burst = 1;
+	data->interval = 1;
+	data->seed = 1;
+	inst->impl = data;
+	return 0;
+}
+
+static channel* generator_channel(instance* inst, char* spec, uint8_t flags){
+	generator_instance_data* data = (generator_instance_data*) inst->impl;
+	char* token = NULL;
+	uint64_t index = strtoul(spec, &token, 10);
+	channel* c = NULL;
+
+	if(*token || !index || index > GENERATOR_MAX_CHANNELS){
+		LOGPF("Invalid channel specification %s", spec);
+		return NULL;
+	}
+
+	if(index >= data->channels){
+		data->channel = realloc(data->channel, (index + 1) * sizeof(generator_slot));
+		if(!data->channel){
+			data->channels = 0;
+			LOG("Failed to allocate memory");
+			return NULL;
+		}
+		memset(data->channel + data->channels, 0, (index + 1 - data->channels) * sizeof(generator_slot));
+		data->channels = index + 1;
+	}
+
+	c = mm_channel(inst, index, 1);
+	if(c && (flags & mmchannel_input) && !data->channel[index].input){
+		//events are generated on all channels mapped as input, in order of appearance
+		data->input = realloc(data->input, (data->inputs + 1) * sizeof(uint64_t));
+		if(!data->input){
+			data->inputs = 0;
+			LOG("Failed to allocate memory");
+			return NULL;
+		}
+		data->input[data->inputs] = index;
+		data->inputs++;
+		data->channel[index].input = 1;
+	}
+	data->channel[index].channel = c;
+	return c;
+}
+
+static void generator_emit(instance* inst, generator_instance_data* data, uint64_t now){
+	generator_slot* chan = data->channel + data->input[data->next];
+	channel_value v = {
+		0
+	};
+
+	switch(data->pattern){
+		case pattern_ramp:
+			chan->value += data->step;
+			if(chan->value > 1.0){
+				chan->value = 0.0;
+			}
+			break;
+		case pattern_random:
+			chan->value = generator_random(data);
+			break;
+		case pattern_toggle:
+			chan->value = (chan->value > 0.5) ? 0.0 : 1.0;
+			break;
+		case pattern_constant:
+			chan->value = data->value;
+			break;
+	}
+
+	v.raw.dbl = v.normalised = chan->value;
+	chan->sent = now;
+	data->next = (data->next + 1) % data->inputs;
+	mm_channel_event(chan->channel, v);
+}
+
+static int generator_timer(uint64_t timer, void* impl){
+	instance* inst = (instance*) impl;
+	generator_instance_data* data = (generator_instance_data*) inst->impl;
+	uint64_t now = generator_clock(), due;
+
+	//events due since the start, emitted in complete bursts so short timer delays do not change the pattern
+	due = ((double) (now - data->start)) * data->rate / 1000000000.0;
+	due -= due % data->burst;
+	if(data->limit){
+		due = min(due, data->limit);
+	}
+
+	if(data->generated < due){
+		for(; data->generated < due; data->generated++){
+			generator_emit(inst, data, now);
+		}
+		data->stop = now;
+	}
+
+	if(data->limit && data->generated >= data->limit){
+		LOGPF("Instance %s generated all %" PRIu64 " events", inst->name, data->limit);
+		mm_timer_cancel(data->timer);
+		data->timer = 0;
+	}
+	return 0;
+}
+
+static int generator_set(instance* inst, size_t num, channel** c, channel_value* v){
+	generator_instance_data* data = (generator_instance_data*) inst->impl;
+	generator_instance_data* source = data->source ? (generator_instance_data*) data->source->impl : data;
+	uint64_t now = generator_clock(), latency;
+	size_t n, bucket;
+
+	if(!data->received){
+		data->first = now;
+	}
+	data->received += num;
+	data->last = now;
+
+	for(n = 0; n < num; n++){
+		//match against the most recent event generated on the same channel number of the source instance
+		if(c[n]->ident >= source->channels || !source->channel[c[n]->ident].sent){
+			continue;
+		}
+
+		latency = (now - source->channel[c[n]->ident].sent) / 1000;
+		source->channel[c[n]->ident].sent = 0;
+
+		data->matched++;
+		data->latency_total += latency;
+		data->latency_min = (data->matched == 1) ? latency : min(data->latency_min, latency);
+		data->latency_max = max(data->latency_max, latency);
+		for(bucket = 0; bucket < GENERATOR_BUCKETS - 1 && (latency >> (bucket + 1)); bucket++){
+		}
+		data->histogram[bucket]++;
+	}
+	return 0;
+}
+
+static int generator_handle(size_t num, managed_fd* fds){
+	//events are generated from timers
+	return 0;
+}
+
+static int generator_start(size_t n, instance** inst){
+	size_t u, p;
+	generator_instance_data* data = NULL;
+
+	for(u = 0; u < n; u++){
+		data = (generator_instance_data*) inst[u]->impl;
+
+		if(data->source_name){
+			for(p = 0; p < n; p++){
+				if(!strcmp(inst[p]->name, data->source_name)){
+					data->source = inst[p];
+					break;
+				}
+			}
+
+			if(!data->source){
+				LOGPF("Source instance %s for instance %s does not exist", data->source_name, inst[u]->name);
+				return 1;
+			}
+		}
+
+		if(!data->inputs || !data->rate){
+			continue;
+		}
+
+		data->start = generator_clock();
+		data->timer = mm_timer_add(BACKEND_NAME, data->interval, data->interval, generator_timer, inst[u]);
+		if(!data->timer){
+			LOGPF("Failed to register generation timer for instance %s", inst[u]->name);
+			return 1;
+		}
+	}
+
+	LOGPF("%" PRIsize_t " instances started", n);
+	return 0;
+}
+
+static uint64_t generator_percentile(generator_instance_data* data, uint64_t permille){
+	uint64_t count = 0;
+	size_t u;
+
+	//the upper bound of the bucket containing the requested sample
+	for(u = 0; u < GENERATOR_BUCKETS; u++){
+		count += data->histogram[u];
+		if(count * 1000 >= data->matched * permille){
+			break;
+		}
+	}
+	return ((uint64_t) 2) << u;
+}
+
+static void generator_report(instance* inst){
+	generator_instance_data* data = (generator_instance_data*) inst->impl;
+
+	if(data->generated){
+		LOGPF("Instance %s generated %" PRIu64 " events in %" PRIu64 " msec (%" PRIu64 " events/s)",
+				inst->name, data->generated, (data->stop - data->start) / 1000000,
+				(data->stop > data->start) ? (uint64_t) (data->generated * 1000000000.0 / (data->stop - data->start)) : 0);
+	}
+
+	if(data->received){
+		LOGPF("Instance %s received %" PRIu64 " events in %" PRIu64 " msec (%" PRIu64 " events/s)",
+				inst->name, data->received, (data->last - data->first) / 1000000,
+				(data->last > data->first) ? (uint64_t) (data->received * 1000000000.0 / (data->last - data->first)) : 0);
+	}
+
+	if(data->matched){
+		LOGPF("Instance %s latency over %" PRIu64 " events: minimum %" PRIu64 " usec, average %" PRIu64 " usec, maximum %" PRIu64 " usec, p50 < %" PRIu64 " usec, p99 < %" PRIu64 " usec",
+				inst->name, data->matched, data->latency_min, data->latency_total / data->matched, data->latency_max,
+				generator_percentile(data, 500), generator_percentile(data, 990));
+	}
+}
+
+static int generator_shutdown(size_t n, instance** inst){
+	size_t u;
+	generator_instance_data* data = NULL;
+
+	for(u = 0; u < n; u++){
+		data = (generator_instance_data*) inst[u]->impl;
+		generator_report(inst[u]);
+
+		if(data->timer){
+			mm_timer_cancel(data->timer);
+		}
+		free(data->source_name);
+		free(data->channel);
+		free(data->input);
+		free(inst[u]->impl);
+		inst[u]->impl = NULL;
+	}
+
+	LOG("Backend shut down");
+	return 0;
+}
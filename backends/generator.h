@@ -0,0 +1,64 @@
+#include "midimonster.h"
+
+MM_PLUGIN_API int init();
+static int generator_configure(char* option, char* value);
+static int generator_configure_instance(instance* inst, char* option, char* value);
+static int generator_instance(instance* inst);
+static channel* generator_channel(instance* inst, char* spec, uint8_t flags);
+static int generator_set(instance* inst, size_t num, channel** c, channel_value* v);
+static int generator_handle(size_t num, managed_fd* fds);
+static int generator_start(size_t n, instance** inst);
+static int generator_shutdown(size_t n, instance** inst);
+
+#define GENERATOR_MAX_CHANNELS 65535
+#define GENERATOR_BUCKETS 24
+
+typedef enum {
+	pattern_ramp = 0,
+	pattern_random,
+	pattern_toggle,
+	pattern_constant
+} generator_pattern;
+
+typedef struct /*_generator_slot*/ {
+	channel* channel;
+	uint8_t input;
+	double value;
+	//time the last generated event on this channel was sent, 0 once it has been received
+	uint64_t sent;
+} generator_slot;
+
+typedef struct /*_generator_instance_data*/ {
+	generator_pattern pattern;
+	double step;
+	double value;
+	uint64_t rate;
+	uint64_t burst;
+	uint32_t interval;
+	uint64_t limit;
+	uint64_t seed;
+	char* source_name;
+	instance* source;
+
+	//channels are indexed by their number, inputs lists the channels to generate events on
+	size_t channels;
+	generator_slot* channel;
+	size_t inputs;
+	uint64_t* input;
+	size_t next;
+
+	uint64_t timer;
+	uint64_t start;
+	uint64_t stop;
+	uint64_t generated;
+
+	//receive statistics
+	uint64_t received;
+	uint64_t first;
+	uint64_t last;
+	uint64_t matched;
+	uint64_t latency_total;
+	uint64_t latency_min;
+	uint64_t latency_max;
+	uint64_t histogram[GENERATOR_BUCKETS];
+} generator_instance_data;
@@ -1,10 +1,8 @@
 #define BACKEND_NAME "jack"
 
 #include <string.h>
+#include <stdlib.h>
 #include <signal.h>
-#include <sys/types.h>
-#include <sys/socket.h>
-#include <unistd.h>
 
 #include "jack.h"
 #include <jack/midiport.h>
@@ -12,12 +10,6 @@
 
 #define JACKEY_SIGNAL_TYPE "http://jackaudio.org/metadata/signal-type"
 
-#ifdef __APPLE__
-	#ifndef PTHREAD_MUTEX_ADAPTIVE_NP
-		#define PTHREAD_MUTEX_ADAPTIVE_NP PTHREAD_MUTEX_DEFAULT
-	#endif
-#endif
-
 static struct /*_mmjack_backend_cfg*/ {
 	unsigned verbosity;
 	volatile sig_atomic_t jack_shutdown;
@@ -36,7 +28,8 @@ MM_PLUGIN_API int init(){
 		.handle = mmjack_set,
 		.process = mmjack_handle,
 		.start = mmjack_start,
-		.shutdown = mmjack_shutdown
+		.shutdown = mmjack_shutdown,
+		.flags = mmbackend_no_echo
 	};
 
 	if(sizeof(mmjack_channel_ident) != sizeof(uint64_t)){
@@ -59,25 +52,75 @@ static void mmjack_message_print(const char* msg){
 static void mmjack_message_ignore(const char* msg){
 }
 
-static int mmjack_midiqueue_append(mmjack_port* port, mmjack_channel_ident ident, uint16_t value){
-	//append events
-	if(port->queue_len == port->queue_alloc){
-		//extend the queue
-		port->queue = realloc(port->queue, (port->queue_len + JACK_MIDIQUEUE_CHUNK) * sizeof(mmjack_midiqueue));
-		if(!port->queue){
-			LOG("Failed to allocate memory");
-			return 1;
+static int mmjack_midiqueue_append(mmjack_port* port, mmjack_channel_ident ident, uint16_t value, uint64_t timestamp){
+	size_t head = port->queue_head;
+
+	//the queue is drained by the process callback, drop events if it can not keep up
+	if(head - __atomic_load_n(&port->queue_tail, __ATOMIC_ACQUIRE) >= JACK_MIDIQUEUE){
+		if(!port->queue_dropped){
+			LOGPF("MIDI output queue for port %s overflowed, dropping events", port->name);
 		}
-		port->queue_alloc += JACK_MIDIQUEUE_CHUNK;
+		port->queue_dropped++;
+		return 1;
 	}
 
-	port->queue[port->queue_len].ident.label = ident.label;
-	port->queue[port->queue_len].raw = value;
-	port->queue_len++;
-	DBGPF("Appended event to queue for %s, now at %" PRIsize_t " entries", port->name, port->queue_len);
+	port->queue[head % JACK_MIDIQUEUE].ident.label = ident.label;
+	port->queue[head % JACK_MIDIQUEUE].raw = value;
+	port->queue[head % JACK_MIDIQUEUE].timestamp = timestamp;
+	__atomic_store_n(&port->queue_head, head + 1, __ATOMIC_RELEASE);
+	DBGPF("Appended event to queue for %s, now at %" PRIsize_t " entries", port->name, head + 1 - port->queue_tail);
 	return 0;
 }
 
+static channel* mmjack_port_lookup(mmjack_port* port, uint64_t label){
+	size_t lower = 0, upper = port->channels, mid;
+
+	//the channel list is not modified after start, so it can be searched from the process callback
+	while(lower < upper){
+		mid = lower + (upper - lower) / 2;
+		if(port->channel[mid].label == label){
+			return port->channel[mid].channel;
+		}
+		else if(port->channel[mid].label < label){
+			lower = mid + 1;
+		}
+		else{
+			upper = mid;
+		}
+	}
+	return NULL;
+}
+
+static void mmjack_process_midiin(mmjack_instance_data* data, mmjack_port* port, mmjack_channel_ident ident, uint16_t value){
+	channel* chan = NULL;
+	channel_value val = {0};
+
+	ident.fields.port = port - data->port;
+	chan = mmjack_port_lookup(port, ident.label);
+	if(!chan){
+		//channel not mapped
+		return;
+	}
+
+	val.normalised = ((double) value) / 127.0;
+	if(ident.fields.sub_type == midi_pitchbend
+			|| ident.fields.sub_type == midi_rpn
+			|| ident.fields.sub_type == midi_nrpn){
+		val.normalised = ((double) value) / 16383.0;
+	}
+
+	DBGPF("Pushing MIDI channel %d type %02X control %d value %f raw %d label %" PRIu64,
+			ident.fields.sub_channel,
+			ident.fields.sub_type,
+			ident.fields.sub_control,
+			val.normalised,
+			value,
+			ident.label);
+	if(mm_channel_event_async(chan, val)){
+		DBGPF("Failed to push MIDI event to core on port %s", port->name);
+	}
+}
+
 static void mmjack_process_midiout(void* buffer, size_t sample_offset, uint8_t type, uint8_t channel, uint8_t control, uint16_t value){
 	jack_midi_data_t* event_data = jack_midi_event_reserve(buffer, sample_offset, (type == midi_aftertouch || type == midi_program) ? 2 : 3);
 
@@ -102,7 +145,7 @@ static void mmjack_process_midiout(void* buffer, size_t sample_offset, uint8_t t
 }
 
 //this state machine was copied more-or-less verbatim from the alsa midi implementation - fixes there will need to be integrated
-static void mmjack_handle_epn(mmjack_port* port, uint8_t chan, uint16_t control, uint16_t value){
+static void mmjack_handle_epn(mmjack_instance_data* data, mmjack_port* port, uint8_t chan, uint16_t control, uint16_t value){
 	mmjack_channel_ident ident = {
 		.label = 0
 	};
@@ -158,18 +201,18 @@ static void mmjack_handle_epn(mmjack_port* port, uint8_t chan, uint16_t control,
 		ident.fields.sub_channel = chan;
 		ident.fields.sub_control = port->epn_control[chan];
 
-		//ident.fields.port set on output in mmjack_handle_midi
-		mmjack_midiqueue_append(port, ident, port->epn_value[chan]);
+		mmjack_process_midiin(data, port, ident, port->epn_value[chan]);
 	}
 }
 
-static int mmjack_process_midi(instance* inst, mmjack_port* port, size_t nframes, size_t* mark){
+static int mmjack_process_midi(instance* inst, mmjack_port* port, size_t nframes){
 	mmjack_instance_data* data = (mmjack_instance_data*) inst->impl;
 	void* buffer = jack_port_get_buffer(port->port, nframes);
 	jack_nframes_t event_count = jack_midi_get_event_count(buffer);
 	jack_midi_event_t event;
 	mmjack_channel_ident ident;
-	size_t u, frame;
+	size_t u, frame, head, tail;
+	uint64_t offset, rate, delta;
 	uint16_t value;
 
 	if(port->input){
@@ -179,7 +222,6 @@ static int mmjack_process_midi(instance* inst, mmjack_port* port, size_t nframes
 				ident.label = 0;
 				//read midi data from stream
 				jack_midi_event_get(&event, buffer, u);
-				//ident.fields.port set on output in mmjack_handle_midi
 				ident.fields.sub_channel = event.buffer[0] & 0x0F;
 				ident.fields.sub_type = event.buffer[0] & 0xF0;
 				ident.fields.sub_control = event.buffer[1];
@@ -202,55 +244,69 @@ static int mmjack_process_midi(instance* inst, mmjack_port* port, size_t nframes
 						&& ((ident.fields.sub_control <= 101 && ident.fields.sub_control >= 98)
 							|| ident.fields.sub_control == 6
 							|| ident.fields.sub_control == 38)){
-					mmjack_handle_epn(port, ident.fields.sub_channel, ident.fields.sub_control, value);
+					mmjack_handle_epn(data, port, ident.fields.sub_channel, ident.fields.sub_control, value);
 				}
 
-				//append midi data
-				mmjack_midiqueue_append(port, ident, value);
+				//push the event to the core directly from the process callback
+				mmjack_process_midiin(data, port, ident, value);
 			}
-			port->mark = 1;
-			*mark = 1;
 		}
 	}
 	else{
 		//clear buffer
 		jack_midi_clear_buffer(buffer);
 
+		rate = jack_get_sample_rate(data->client);
 		frame = 0;
-		for(u = 0; u < port->queue_len; u++){
-			ident.label = port->queue[u].ident.label;
+		tail = port->queue_tail;
+		head = __atomic_load_n(&port->queue_head, __ATOMIC_ACQUIRE);
+		for(u = tail; u != head; u++){
+			ident.label = port->queue[u % JACK_MIDIQUEUE].ident.label;
+
+			//keep the relative timing of the queued events within this period.
+			//events are stamped at their origin, so the queue is not strictly ordered - older or unstamped events go first
+			offset = 0;
+			if(port->queue[tail % JACK_MIDIQUEUE].timestamp
+					&& port->queue[u % JACK_MIDIQUEUE].timestamp > port->queue[tail % JACK_MIDIQUEUE].timestamp){
+				delta = port->queue[u % JACK_MIDIQUEUE].timestamp - port->queue[tail % JACK_MIDIQUEUE].timestamp;
+				//anything more than a second apart ends up on the last frame anyway, this also keeps the product from overflowing
+				offset = (delta >= 1000000000) ? nframes : (delta * rate) / 1000000000;
+			}
+			frame = clamp(max(frame, offset), nframes - 1, 0);
 
 			if(ident.fields.sub_type == midi_rpn
 					|| ident.fields.sub_type == midi_nrpn){
 				//transmit parameter number
-				mmjack_process_midiout(buffer, frame++, midi_cc, ident.fields.sub_channel, (ident.fields.sub_type == midi_rpn) ? 101 : 99, (ident.fields.sub_control >> 7) & 0x7F);
-				mmjack_process_midiout(buffer, frame++, midi_cc, ident.fields.sub_channel, (ident.fields.sub_type == midi_rpn) ? 100 : 98, ident.fields.sub_control & 0x7F);
+				mmjack_process_midiout(buffer, frame, midi_cc, ident.fields.sub_channel, (ident.fields.sub_type == midi_rpn) ? 101 : 99, (ident.fields.sub_control >> 7) & 0x7F);
+				mmjack_process_midiout(buffer, frame, midi_cc, ident.fields.sub_channel, (ident.fields.sub_type == midi_rpn) ? 100 : 98, ident.fields.sub_control & 0x7F);
 
 				//transmit parameter value
-				mmjack_process_midiout(buffer, frame++, midi_cc, ident.fields.sub_channel, 6, (port->queue[u].raw >> 7) & 0x7F);
-				mmjack_process_midiout(buffer, frame++, midi_cc, ident.fields.sub_channel, 38, port->queue[u].raw & 0x7F);
+				mmjack_process_midiout(buffer, frame, midi_cc, ident.fields.sub_channel, 6, (port->queue[u % JACK_MIDIQUEUE].raw >> 7) & 0x7F);
+				mmjack_process_midiout(buffer, frame, midi_cc, ident.fields.sub_channel, 38, port->queue[u % JACK_MIDIQUEUE].raw & 0x7F);
 
 				if(!data->midi_epn_tx_short){
 					//clear active parameter
-					mmjack_process_midiout(buffer, frame++, midi_cc, ident.fields.sub_channel, 101, 127);
-					mmjack_process_midiout(buffer, frame++, midi_cc, ident.fields.sub_channel, 100, 127);
+					mmjack_process_midiout(buffer, frame, midi_cc, ident.fields.sub_channel, 101, 127);
+					mmjack_process_midiout(buffer, frame, midi_cc, ident.fields.sub_channel, 100, 127);
 				}
 			}
 			else{
-				mmjack_process_midiout(buffer, frame++, ident.fields.sub_type, ident.fields.sub_channel, ident.fields.sub_control, port->queue[u].raw);
+				mmjack_process_midiout(buffer, frame, ident.fields.sub_type, ident.fields.sub_channel, ident.fields.sub_control, port->queue[u % JACK_MIDIQUEUE].raw);
 			}
 		}
 
-		if(frame){
-			DBGPF("Wrote %" PRIsize_t " MIDI events to port %s", frame, port->name);
+		if(head != tail){
+			DBGPF("Wrote %" PRIsize_t " MIDI events to port %s", head - tail, port->name);
 		}
-		port->queue_len = 0;
+		__atomic_store_n(&port->queue_tail, head, __ATOMIC_RELEASE);
 	}
 	return 0;
 }
 
-static int mmjack_process_cv(instance* inst, mmjack_port* port, size_t nframes, size_t* mark){
+static int mmjack_process_cv(instance* inst, mmjack_port* port, size_t nframes){
 	jack_default_audio_sample_t* audio_buffer = jack_port_get_buffer(port->port, nframes);
+	double value;
+	channel_value val = {0};
 	size_t u;
 
 	if(port->input){
@@ -258,13 +314,25 @@ static int mmjack_process_cv(instance* inst, mmjack_port* port, size_t nframes,
 		//FIXME maybe we don't want to always use the first sample...
 		if((double) audio_buffer[0] != port->last){
 			port->last = audio_buffer[0];
-			port->mark = 1;
-			*mark = 1;
+			if(!port->channels){
+				//this might happen if a channel is registered but not mapped
+				return 0;
+			}
+
+			//normalize value
+			val.normalised = (port->last - port->min) / (port->max - port->min);
+			val.normalised = clamp(val.normalised, 1.0, 0.0);
+			DBGPF("Pushing CV channel %s value %f raw %f min %f max %f", port->name, val.normalised, port->last, port->min, port->max);
+			if(mm_channel_event_async(port->channel[0].channel, val)){
+				DBGPF("Failed to push CV event to core for %s.%s", inst->name, port->name);
+			}
 		}
 	}
 	else{
+		//the output value is updated concurrently by the core
+		__atomic_load(&port->last, &value, __ATOMIC_RELAXED);
 		for(u = 0; u < nframes; u++){
-			audio_buffer[u] = port->last;
+			audio_buffer[u] = value;
 		}
 	}
 	return 0;
@@ -273,36 +341,25 @@ static int mmjack_process_cv(instance* inst, mmjack_port* port, size_t nframes,
 static int mmjack_process(jack_nframes_t nframes, void* instp){
 	instance* inst = (instance*) instp;
 	mmjack_instance_data* data = (mmjack_instance_data*) inst->impl;
-	size_t p, mark = 0;
+	size_t p;
 	int rv = 0;
 
 	//DBGPF("jack callback for %d frames on %s", nframes, inst->name);
 
 	for(p = 0; p < data->ports; p++){
-		pthread_mutex_lock(&data->port[p].lock);
 		switch(data->port[p].type){
 			case port_midi:
 				//DBGPF("Handling MIDI port %s.%s", inst->name, data->port[p].name);
-				rv |= mmjack_process_midi(inst, data->port + p, nframes, &mark);
+				rv |= mmjack_process_midi(inst, data->port + p, nframes);
 				break;
 			case port_cv:
 				//DBGPF("Handling CV port %s.%s", inst->name, data->port[p].name);
-				rv |= mmjack_process_cv(inst, data->port + p, nframes, &mark);
+				rv |= mmjack_process_cv(inst, data->port + p, nframes);
 				break;
 			default:
 				LOG("Unhandled port type in processing callback");
-				pthread_mutex_unlock(&data->port[p].lock);
 				return 1;
 		}
-		pthread_mutex_unlock(&data->port[p].lock);
-	}
-
-	//notify the main thread
-	if(mark){
-		DBGPF("Notifying handler thread for instance %s", inst->name);
-		if(send(data->fd, "c", 1, 0) != 1){
-			DBGPF("Failed to notify main thread on %s", inst->name);
-		}
 	}
 	return rv;
 }
@@ -526,6 +583,8 @@ static channel* mmjack_channel(instance* inst, char* spec, uint8_t flags){
 	mmjack_channel_ident ident = {
 		.label = 0
 	};
+	mmjack_port_channel* port_channel = NULL;
+	channel* chan = NULL;
 	size_t u;
 
 	for(u = 0; u < data->ports; u++){
@@ -552,7 +611,20 @@ static channel* mmjack_channel(instance* inst, char* spec, uint8_t flags){
 		//TODO parse osc subspec
 	}
 
-	return mm_channel(inst, ident.label, 1);
+	chan = mm_channel(inst, ident.label, 1);
+	if(chan && data->port[u].input){
+		//remember the channel for input events generated in the process callback
+		port_channel = realloc(data->port[u].channel, (data->port[u].channels + 1) * sizeof(mmjack_port_channel));
+		if(!port_channel){
+			LOG("Failed to allocate memory");
+			return NULL;
+		}
+		data->port[u].channel = port_channel;
+		data->port[u].channel[data->port[u].channels].label = ident.label;
+		data->port[u].channel[data->port[u].channels].channel = chan;
+		data->port[u].channels++;
+	}
+	return chan;
 }
 
 static int mmjack_set(instance* inst, size_t num, channel** c, channel_value* v){
@@ -561,7 +633,7 @@ static int mmjack_set(instance* inst, size_t num, channel** c, channel_value* v)
 		.label = 0
 	};
 	size_t u;
-	double range;
+	double range, last;
 	uint16_t value;
 
 	for(u = 0; u < num; u++){
@@ -573,12 +645,12 @@ static int mmjack_set(instance* inst, size_t num, channel** c, channel_value* v)
 		}
 		range = data->port[ident.fields.port].max - data->port[ident.fields.port].min;
 
-		pthread_mutex_lock(&data->port[ident.fields.port].lock);
 		switch(data->port[ident.fields.port].type){
 			case port_cv:
-				//scale value to given range
-				data->port[ident.fields.port].last = (range * v[u].normalised) + data->port[ident.fields.port].min;
-				DBGPF("CV port %s updated to %f", data->port[ident.fields.port].name, data->port[ident.fields.port].last);
+				//scale value to given range, the process callback picks it up with the next period
+				last = (range * v[u].normalised) + data->port[ident.fields.port].min;
+				__atomic_store(&data->port[ident.fields.port].last, &last, __ATOMIC_RELAXED);
+				DBGPF("CV port %s updated to %f", data->port[ident.fields.port].name, last);
 				break;
 			case port_midi:
 				value = v[u].normalised * 127.0;
@@ -588,130 +660,57 @@ static int mmjack_set(instance* inst, size_t num, channel** c, channel_value* v)
 					value = ((uint16_t)(v[u].normalised * 16383.0));
 				}
 
-				if(mmjack_midiqueue_append(data->port + ident.fields.port, ident, value)){
-					pthread_mutex_unlock(&data->port[ident.fields.port].lock);
-					return 1;
-				}
+				mmjack_midiqueue_append(data->port + ident.fields.port, ident, value, v[u].timestamp);
 				break;
 			default:
 				LOGPF("No handler implemented for port type %s.%s", inst->name, data->port[ident.fields.port].name);
 				break;
 		}
-		pthread_mutex_unlock(&data->port[ident.fields.port].lock);
 	}
 
 	return 0;
 }
 
-static void mmjack_handle_midi(instance* inst, size_t index, mmjack_port* port){
-	size_t u;
-	channel* chan = NULL;
-	channel_value val;
-
-	for(u = 0; u < port->queue_len; u++){
-		port->queue[u].ident.fields.port = index;
-		chan = mm_channel(inst, port->queue[u].ident.label, 0);
-		if(chan){
-			if(port->queue[u].ident.fields.sub_type == midi_pitchbend
-					|| port->queue[u].ident.fields.sub_type == midi_rpn
-					|| port->queue[u].ident.fields.sub_type == midi_nrpn){
-				val.normalised = ((double)port->queue[u].raw) / 16383.0;
-			}
-			else{
-				val.normalised = ((double)port->queue[u].raw) / 127.0;
-			}
-			DBGPF("Pushing MIDI channel %d type %02X control %d value %f raw %d label %" PRIu64,
-					port->queue[u].ident.fields.sub_channel,
-					port->queue[u].ident.fields.sub_type,
-					port->queue[u].ident.fields.sub_control,
-					val.normalised,
-					port->queue[u].raw,
-					port->queue[u].ident.label);
-			if(mm_channel_event(chan, val)){
-				LOGPF("Failed to push MIDI event to core on port %s.%s", inst->name, port->name);
-			}
-		}
-	}
-
-	if(port->queue_len){
-		DBGPF("Pushed %" PRIsize_t " MIDI events to core for port %s.%s", port->queue_len, inst->name, port->name);
+static int mmjack_handle(size_t num, managed_fd* fds){
+	//input events are pushed to the core directly from the process callback
+	if(config.jack_shutdown){
+		LOG("Server disconnected");
+		return 1;
 	}
-	port->queue_len = 0;
+	return 0;
 }
 
-static void mmjack_handle_cv(instance* inst, size_t index, mmjack_port* port){
-	mmjack_channel_ident ident = {
-		.fields.port = index
-	};
-	double range;
-	channel_value val;
-
-	channel* chan = mm_channel(inst, ident.label, 0);
-	if(!chan){
-		//this might happen if a channel is registered but not mapped
-		DBGPF("Failed to match CV channel %s.%s to core channel", inst->name, port->name);
-		return;
-	}
-
-	//normalize value
-	range = port->max - port->min;
-	val.normalised = port->last - port->min;
-	val.normalised /= range;
-	val.normalised = clamp(val.normalised, 1.0, 0.0);
-	DBGPF("Pushing CV channel %s value %f raw %f min %f max %f", port->name, val.normalised, port->last, port->min, port->max);
-	if(mm_channel_event(chan, val)){
-		LOGPF("Failed to push CV event to core for %s.%s", inst->name, port->name);
-	}
+static int mmjack_port_channel_compare(const void* a, const void* b){
+	uint64_t label_a = ((mmjack_port_channel*) a)->label, label_b = ((mmjack_port_channel*) b)->label;
+	return (label_a > label_b) - (label_a < label_b);
 }
 
-static int mmjack_handle(size_t num, managed_fd* fds){
-	size_t u, p;
-	instance* inst = NULL;
-	mmjack_instance_data* data = NULL;
-	ssize_t bytes;
-	uint8_t recv_buf[1024];
-
-	for(u = 0; u < num; u++){
-		inst = (instance*) fds[u].impl;
-		data = (mmjack_instance_data*) inst->impl;
-		bytes = recv(fds[u].fd, recv_buf, sizeof(recv_buf), 0);
-		if(bytes < 0){
-			LOGPF("Failed to receive on feedback socket for instance %s", inst->name);
-			return 1;
-		}
-
-		for(p = 0; p < data->ports; p++){
-			if(data->port[p].input && data->port[p].mark){
-				pthread_mutex_lock(&data->port[p].lock);
-				switch(data->port[p].type){
-					case port_cv:
-						mmjack_handle_cv(inst, p, data->port + p);
-						break;
-					case port_midi:
-						mmjack_handle_midi(inst, p, data->port + p);
-						break;
-					default:
-						LOGPF("Output handler not implemented for unknown channel type on %s.%s", inst->name, data->port[p].name);
-						break;
-				}
+static int mmjack_port_prepare(mmjack_port* port){
+	size_t u, n = 0;
 
-				data->port[p].mark = 0;
-				pthread_mutex_unlock(&data->port[p].lock);
+	if(port->input){
+		//sort the mapped channels and drop duplicates from repeated mappings
+		qsort(port->channel, port->channels, sizeof(mmjack_port_channel), mmjack_port_channel_compare);
+		for(u = 0; u < port->channels; u++){
+			if(!n || port->channel[n - 1].label != port->channel[u].label){
+				port->channel[n] = port->channel[u];
+				n++;
 			}
 		}
+		port->channels = n;
 	}
-
-	if(config.jack_shutdown){
-		LOG("Server disconnected");
-		return 1;
+	else if(port->type == port_midi){
+		port->queue = calloc(JACK_MIDIQUEUE, sizeof(mmjack_midiqueue));
+		if(!port->queue){
+			LOG("Failed to allocate memory");
+			return 1;
+		}
 	}
 	return 0;
 }
 
 static int mmjack_start(size_t n, instance** inst){
-	int rv = 1, feedback_fd[2];
 	size_t u, p;
-	pthread_mutexattr_t mutex_attr;
 	mmjack_instance_data* data = NULL;
 	jack_status_t error;
 
@@ -725,13 +724,6 @@ static int mmjack_start(size_t n, instance** inst){
 		jack_set_info_function(mmjack_message_print);
 	}
 
-	//prepare mutex attributes because the initializer macro for adaptive mutexes is a GNU extension...
-	if(pthread_mutexattr_init(&mutex_attr)
-			|| pthread_mutexattr_settype(&mutex_attr, PTHREAD_MUTEX_ADAPTIVE_NP)){
-		LOG("Failed to initialize mutex attributes");
-		goto bail;
-	}
-
 	for(u = 0; u < n; u++){
 		data = (mmjack_instance_data*) inst[u]->impl;
 
@@ -744,19 +736,7 @@ static int mmjack_start(size_t n, instance** inst){
 		if(!data->client){
 			//TODO pretty-print failures
 			LOGPF("Failed to connect to server, return status %u", error);
-			goto bail;
-		}
-
-		//set up the feedback fd
-		if(socketpair(AF_LOCAL, SOCK_DGRAM, 0, feedback_fd)){
-			LOG("Failed to create feedback socket pair");
-			goto bail;
-		}
-
-		data->fd = feedback_fd[0];
-		if(mm_manage_fd(feedback_fd[1], BACKEND_NAME, 1, inst[u])){
-			LOG("Failed to register feedback FD with core");
-			goto bail;
+			return 1;
 		}
 
 		//connect jack callbacks
@@ -767,9 +747,8 @@ static int mmjack_start(size_t n, instance** inst){
 
 		//create and initialize jack ports
 		for(p = 0; p < data->ports; p++){
-			if(pthread_mutex_init(&(data->port[p].lock), &mutex_attr)){
-				LOG("Failed to create port mutex");
-				goto bail;
+			if(mmjack_port_prepare(data->port + p)){
+				return 1;
 			}
 
 			data->port[p].port = jack_port_register(data->client,
@@ -782,22 +761,19 @@ static int mmjack_start(size_t n, instance** inst){
 
 			if(!data->port[p].port){
 				LOGPF("Failed to create port %s.%s", inst[u]->name, data->port[p].name);
-				goto bail;
+				return 1;
 			}
 		}
 
 		//do the thing
 		if(jack_activate(data->client)){
 			LOGPF("Failed to activate client for instance %s", inst[u]->name);
-			goto bail;
+			return 1;
 		}
 	}
 
-	LOGPF("Registered %" PRIsize_t " descriptors to core", n);
-	rv = 0;
-bail:
-	pthread_mutexattr_destroy(&mutex_attr);
-	return rv;
+	LOGPF("Started %" PRIsize_t " clients", n);
+	return 0;
 }
 
 static int mmjack_shutdown(size_t n, instance** inst){
@@ -821,11 +797,16 @@ static int mmjack_shutdown(size_t n, instance** inst){
 			free(data->port[p].name);
 			data->port[p].name = NULL;
 
+			if(data->port[p].queue_dropped){
+				LOGPF("Dropped %" PRIsize_t " MIDI events on port %s.%s", data->port[p].queue_dropped, inst[u]->name, data->port[p].name);
+			}
 			free(data->port[p].queue);
 			data->port[p].queue = NULL;
-			data->port[p].queue_alloc = data->port[p].queue_len = 0;
+			data->port[p].queue_head = data->port[p].queue_tail = 0;
 
-			pthread_mutex_destroy(&data->port[p].lock);
+			free(data->port[p].channel);
+			data->port[p].channel = NULL;
+			data->port[p].channels = 0;
 		}
 
 		//terminate jack connection
@@ -838,8 +819,6 @@ static int mmjack_shutdown(size_t n, instance** inst){
 		data->server_name = NULL;
 		free(data->client_name);
 		data->client_name = NULL;
-		close(data->fd);
-		data->fd = -1;
 
 		free(inst[u]->impl);
 	}
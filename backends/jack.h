@@ -1,6 +1,5 @@
 #include "midimonster.h"
 #include <jack/jack.h>
-#include <pthread.h>
 
 MM_PLUGIN_API int init();
 static int mmjack_configure(char* option, char* value);
@@ -14,7 +13,7 @@ static int mmjack_shutdown(size_t n, instance** inst);
 
 #define JACK_DEFAULT_CLIENT_NAME "MIDIMonster"
 #define JACK_DEFAULT_SERVER_NAME "default"
-#define JACK_MIDIQUEUE_CHUNK 10
+#define JACK_MIDIQUEUE 1024
 
 #define EPN_NRPN 8
 #define EPN_PARAMETER_HI 4
@@ -53,8 +52,14 @@ typedef enum /*_mmjack_port_type*/ {
 typedef struct /*_mmjack_midiqueue_entry*/ {
 	mmjack_channel_ident ident;
 	uint16_t raw;
+	uint64_t timestamp;
 } mmjack_midiqueue;
 
+typedef struct /*_mmjack_port_channel*/ {
+	uint64_t label;
+	channel* channel;
+} mmjack_port_channel;
+
 typedef struct /*_mmjack_port_data*/ {
 	char* name;
 	mmjack_port_type type;
@@ -63,24 +68,26 @@ typedef struct /*_mmjack_port_data*/ {
 
 	double max;
 	double min;
-	uint8_t mark;
 	double last;
 
-	size_t queue_len;
-	size_t queue_alloc;
+	//channels mapped on input ports, sorted by label on start for lookup from the process callback
+	size_t channels;
+	mmjack_port_channel* channel;
+
+	//output event ring, filled by the core and drained by the process callback
+	size_t queue_head;
+	size_t queue_tail;
+	size_t queue_dropped;
 	mmjack_midiqueue* queue;
 
 	uint16_t epn_control[16];
 	uint16_t epn_value[16];
 	uint8_t epn_status[16];
-
-	pthread_mutex_t lock;
 } mmjack_port;
 
 typedef struct /*_jack_instance_data*/ {
 	char* server_name;
 	char* client_name;
-	int fd;
 
 	uint8_t midi_epn_tx_short;
 
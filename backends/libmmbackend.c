@@ -1,4 +1,22 @@
+#ifdef __linux__
+	//required for recvmmsg and sendmmsg
+	#define _GNU_SOURCE
+	//build with -DMMBACKEND_NO_MMSG to use one system call per datagram, e.g. for comparison
+	#ifndef MMBACKEND_NO_MMSG
+		#define MMBACKEND_MMSG
+	#endif
+#endif
 #include "libmmbackend.h"
+//build with -DMMBACKEND_NO_SIMD to use the portable frame comparison, e.g. for comparison
+#ifndef MMBACKEND_NO_SIMD
+	#if defined(__AVX2__)
+		#define MMBACKEND_AVX2
+		#include <immintrin.h>
+	#elif defined(__SSE2__)
+		#define MMBACKEND_SSE2
+		#include <emmintrin.h>
+	#endif
+#endif
 
 #define LOGPF(format, ...) fprintf(stderr, "libmmbe\t" format "\n", __VA_ARGS__)
 #define LOG(message) fprintf(stderr, "libmmbe\t%s\n", (message))
@@ -251,6 +269,436 @@ int mmbackend_send_str(int fd, char* data){
 	return mmbackend_send(fd, (uint8_t*) data, strlen(data));
 }
 
+int mmbackend_recv_init(mmbackend_recv_batch* batch, size_t slots, size_t size){
+	#ifdef MMBACKEND_MMSG
+	struct mmsghdr* msg = NULL;
+	struct iovec* iov = NULL;
+	#endif
+	size_t u;
+
+	mmbackend_recv_free(batch);
+	batch->buffer = calloc(slots, size);
+	batch->length = calloc(slots, sizeof(size_t));
+	batch->peer = calloc(slots, sizeof(struct sockaddr_storage));
+	batch->peer_len = calloc(slots, sizeof(socklen_t));
+	#ifdef MMBACKEND_MMSG
+	batch->headers = calloc(slots, sizeof(struct mmsghdr) + sizeof(struct iovec));
+	#endif
+	if(!batch->buffer || !batch->length || !batch->peer || !batch->peer_len
+	#ifdef MMBACKEND_MMSG
+			|| !batch->headers
+	#endif
+			){
+		LOG("Failed to allocate memory");
+		mmbackend_recv_free(batch);
+		return 1;
+	}
+
+	batch->slots = slots;
+	batch->size = size;
+
+	#ifdef MMBACKEND_MMSG
+	//message headers point into the packet buffers permanently, only the address lengths are reset per call
+	msg = (struct mmsghdr*) batch->headers;
+	iov = (struct iovec*) (msg + slots);
+	for(u = 0; u < slots; u++){
+		iov[u].iov_base = batch->buffer + u * size;
+		iov[u].iov_len = size;
+		msg[u].msg_hdr.msg_iov = iov + u;
+		msg[u].msg_hdr.msg_iovlen = 1;
+		msg[u].msg_hdr.msg_name = batch->peer + u;
+	}
+	#else
+	for(u = 0; u < slots; u++){
+		batch->peer_len[u] = sizeof(struct sockaddr_storage);
+	}
+	#endif
+	return 0;
+}
+
+ssize_t mmbackend_recv(mmbackend_recv_batch* batch, int fd){
+	ssize_t n = 0;
+	#ifdef MMBACKEND_MMSG
+	struct mmsghdr* msg = (struct mmsghdr*) batch->headers;
+	size_t u;
+
+	for(u = 0; u < batch->slots; u++){
+		msg[u].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+	}
+
+	batch->calls++;
+	n = recvmmsg(fd, msg, batch->slots, MSG_DONTWAIT, NULL);
+	if(n < 0){
+		return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+	}
+
+	for(u = 0; u < n; u++){
+		batch->length[u] = msg[u].msg_len;
+		batch->peer_len[u] = msg[u].msg_hdr.msg_namelen;
+	}
+	#else
+	ssize_t bytes;
+
+	for(n = 0; n < batch->slots; n++){
+		batch->calls++;
+		batch->peer_len[n] = sizeof(struct sockaddr_storage);
+		bytes = recvfrom(fd, (char*) batch->buffer + n * batch->size, batch->size, 0, (struct sockaddr*) (batch->peer + n), batch->peer_len + n);
+		if(bytes < 0){
+			#ifdef _WIN32
+			if(WSAGetLastError() != WSAEWOULDBLOCK && !n){
+			#else
+			if(errno != EAGAIN && errno != EWOULDBLOCK && !n){
+			#endif
+				return -1;
+			}
+			//errors after some packets were received are reported by the next call
+			break;
+		}
+		batch->length[n] = bytes;
+	}
+	#endif
+
+	batch->packets += n;
+	return n;
+}
+
+void mmbackend_recv_free(mmbackend_recv_batch* batch){
+	free(batch->buffer);
+	free(batch->length);
+	free(batch->peer);
+	free(batch->peer_len);
+	free(batch->headers);
+	batch->buffer = NULL;
+	batch->length = NULL;
+	batch->peer = NULL;
+	batch->peer_len = NULL;
+	batch->headers = NULL;
+	batch->slots = batch->size = 0;
+}
+
+int mmbackend_send_init(mmbackend_send_batch* batch, size_t slots){
+	mmbackend_send_free(batch);
+	batch->data = calloc(slots, sizeof(uint8_t*));
+	batch->length = calloc(slots, sizeof(size_t));
+	batch->dest = calloc(slots, sizeof(struct sockaddr*));
+	batch->dest_len = calloc(slots, sizeof(socklen_t));
+	#ifdef MMBACKEND_MMSG
+	batch->headers = calloc(slots, sizeof(struct mmsghdr) + sizeof(struct iovec));
+	#endif
+	if(!batch->data || !batch->length || !batch->dest || !batch->dest_len
+	#ifdef MMBACKEND_MMSG
+			|| !batch->headers
+	#endif
+			){
+		LOG("Failed to allocate memory");
+		mmbackend_send_free(batch);
+		return 1;
+	}
+
+	batch->slots = slots;
+	batch->pending = 0;
+	return 0;
+}
+
+int mmbackend_send_queue(mmbackend_send_batch* batch, uint8_t* data, size_t length, struct sockaddr* dest, socklen_t dest_len){
+	#ifdef MMBACKEND_MMSG
+	struct mmsghdr* msg = (struct mmsghdr*) batch->headers;
+	struct iovec* iov = (struct iovec*) (msg + batch->slots);
+	#endif
+
+	if(batch->pending >= batch->slots){
+		return 1;
+	}
+
+	batch->data[batch->pending] = data;
+	batch->length[batch->pending] = length;
+	batch->dest[batch->pending] = dest;
+	batch->dest_len[batch->pending] = dest_len;
+
+	#ifdef MMBACKEND_MMSG
+	iov[batch->pending].iov_base = data;
+	iov[batch->pending].iov_len = length;
+	memset(&msg[batch->pending].msg_hdr, 0, sizeof(msg[batch->pending].msg_hdr));
+	msg[batch->pending].msg_hdr.msg_iov = iov + batch->pending;
+	msg[batch->pending].msg_hdr.msg_iovlen = 1;
+	msg[batch->pending].msg_hdr.msg_name = dest;
+	msg[batch->pending].msg_hdr.msg_namelen = dest_len;
+	#endif
+
+	batch->pending++;
+	return 0;
+}
+
+size_t mmbackend_send_flush(mmbackend_send_batch* batch, int fd){
+	size_t sent = 0;
+	#ifdef MMBACKEND_MMSG
+	int rv;
+
+	//sendmmsg may transmit only part of the batch, continue until it fails
+	while(sent < batch->pending){
+		batch->calls++;
+		rv = sendmmsg(fd, ((struct mmsghdr*) batch->headers) + sent, batch->pending - sent, 0);
+		if(rv <= 0){
+			break;
+		}
+		sent += rv;
+	}
+	#else
+	for(; sent < batch->pending; sent++){
+		batch->calls++;
+		if(sendto(fd, (char*) batch->data[sent], batch->length[sent], 0, batch->dest[sent], batch->dest_len[sent]) < 0){
+			break;
+		}
+	}
+	#endif
+
+	batch->packets += sent;
+	batch->pending = 0;
+	return sent;
+}
+
+void mmbackend_send_free(mmbackend_send_batch* batch){
+	free(batch->data);
+	free(batch->length);
+	free(batch->dest);
+	free(batch->dest_len);
+	free(batch->headers);
+	batch->data = NULL;
+	batch->length = NULL;
+	batch->dest = NULL;
+	batch->dest_len = NULL;
+	batch->headers = NULL;
+	batch->slots = batch->pending = 0;
+}
+
+//marks slots not owned by any source
+#define MMBACKEND_MERGE_NONE 0xFF
+
+static void mmbackend_merge_drop(mmbackend_merge* merge, size_t index){
+	size_t p;
+
+	//move the last source into the freed entry
+	merge->sources--;
+	if(index != merge->sources){
+		memcpy(merge->source + index, merge->source + merge->sources, sizeof(mmbackend_merge_source));
+	}
+
+	for(p = 0; p < MMBACKEND_MERGE_SLOTS; p++){
+		if(merge->owner[p] == index){
+			merge->owner[p] = MMBACKEND_MERGE_NONE;
+		}
+		else if(merge->owner[p] == merge->sources){
+			merge->owner[p] = index;
+		}
+	}
+}
+
+static ssize_t mmbackend_merge_find(mmbackend_merge* merge, uint8_t* id, size_t id_len, uint64_t now, uint8_t* created){
+	uint8_t key[MMBACKEND_MERGE_ID] = {
+		0
+	};
+	size_t u;
+
+	memcpy(key, id, (id_len < MMBACKEND_MERGE_ID) ? id_len : MMBACKEND_MERGE_ID);
+
+	//expire sources that stopped sending
+	for(u = 0; u < merge->sources;){
+		if(now - merge->source[u].last > merge->timeout){
+			mmbackend_merge_drop(merge, u);
+			continue;
+		}
+		u++;
+	}
+
+	for(u = 0; u < merge->sources; u++){
+		if(!memcmp(merge->source[u].id, key, sizeof(key))){
+			merge->source[u].last = now;
+			return u;
+		}
+	}
+
+	if(merge->sources >= MMBACKEND_MERGE_SOURCES){
+		return -1;
+	}
+
+	merge->source = realloc(merge->source, (merge->sources + 1) * sizeof(mmbackend_merge_source));
+	if(!merge->source){
+		merge->sources = 0;
+		LOG("Failed to allocate memory");
+		return -1;
+	}
+
+	memset(merge->source + merge->sources, 0, sizeof(mmbackend_merge_source));
+	memcpy(merge->source[merge->sources].id, key, sizeof(key));
+	merge->source[merge->sources].last = now;
+	*created = 1;
+	return merge->sources++;
+}
+
+static void mmbackend_merge_compute(mmbackend_merge* merge){
+	size_t p, u;
+	ssize_t best;
+	uint8_t priority, best_priority, value;
+	mmbackend_merge_source* source = NULL;
+
+	//without any sources, all slots fall back to zero
+	if(!merge->sources){
+		memset(merge->merged, 0, MMBACKEND_MERGE_SLOTS);
+		return;
+	}
+
+	//a single source without per-address priorities is passed through
+	if(merge->sources == 1 && !merge->source[0].address_priorities){
+		memcpy(merge->merged, merge->source[0].data, MMBACKEND_MERGE_SLOTS);
+		return;
+	}
+
+	for(p = 0; p < MMBACKEND_MERGE_SLOTS; p++){
+		best = -1;
+		best_priority = value = 0;
+		for(u = 0; u < merge->sources; u++){
+			source = merge->source + u;
+			priority = source->address_priorities ? source->address_priority[p] : source->priority;
+			if(source->address_priorities && !priority){
+				continue;
+			}
+
+			if(best < 0 || priority > best_priority){
+				best = u;
+				best_priority = priority;
+				value = source->data[p];
+			}
+			else if(priority == best_priority){
+				if(merge->mode == merge_htp){
+					value = (source->data[p] > value) ? source->data[p] : value;
+				}
+				//prefer the source that last changed the slot, otherwise the one heard from most recently
+				else if(merge->owner[p] != best
+						&& (merge->owner[p] == u || source->last > merge->source[best].last)){
+					best = u;
+					value = source->data[p];
+				}
+			}
+		}
+		merge->merged[p] = value;
+	}
+}
+
+int mmbackend_merge_update(mmbackend_merge* merge, uint8_t* id, size_t id_len, uint8_t priority, uint8_t* data, size_t length, uint64_t now){
+	uint8_t created = 0;
+	ssize_t index = mmbackend_merge_find(merge, id, id_len, now, &created);
+	mmbackend_merge_source* source = NULL;
+	size_t p;
+
+	if(index < 0){
+		return 1;
+	}
+
+	source = merge->source + index;
+	source->priority = priority;
+	length = (length < MMBACKEND_MERGE_SLOTS) ? length : MMBACKEND_MERGE_SLOTS;
+	for(p = 0; p < length; p++){
+		if(created || source->data[p] != data[p]){
+			source->data[p] = data[p];
+			merge->owner[p] = index;
+		}
+	}
+
+	mmbackend_merge_compute(merge);
+	return 0;
+}
+
+int mmbackend_merge_priority(mmbackend_merge* merge, uint8_t* id, size_t id_len, uint8_t* priority, size_t length, uint64_t now){
+	uint8_t created = 0;
+	ssize_t index = mmbackend_merge_find(merge, id, id_len, now, &created);
+
+	if(index < 0){
+		return 1;
+	}
+
+	length = (length < MMBACKEND_MERGE_SLOTS) ? length : MMBACKEND_MERGE_SLOTS;
+	merge->source[index].address_priorities = 1;
+	memcpy(merge->source[index].address_priority, priority, length);
+	memset(merge->source[index].address_priority + length, 0, MMBACKEND_MERGE_SLOTS - length);
+
+	mmbackend_merge_compute(merge);
+	return 0;
+}
+
+int mmbackend_merge_remove(mmbackend_merge* merge, uint8_t* id, size_t id_len){
+	uint8_t key[MMBACKEND_MERGE_ID] = {
+		0
+	};
+	size_t u;
+
+	memcpy(key, id, (id_len < MMBACKEND_MERGE_ID) ? id_len : MMBACKEND_MERGE_ID);
+	for(u = 0; u < merge->sources; u++){
+		if(!memcmp(merge->source[u].id, key, sizeof(key))){
+			mmbackend_merge_drop(merge, u);
+			mmbackend_merge_compute(merge);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+void mmbackend_merge_free(mmbackend_merge* merge){
+	free(merge->source);
+	merge->source = NULL;
+	merge->sources = 0;
+}
+
+//changed active slots within 64 bytes of a frame, one bit per slot
+static inline uint64_t mmbackend_diff_block(uint8_t* previous, uint8_t* current, uint8_t* active){
+	#if defined(MMBACKEND_AVX2)
+	__m256i low = _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i*) previous), _mm256_loadu_si256((__m256i*) current));
+	__m256i high = _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i*) (previous + 32)), _mm256_loadu_si256((__m256i*) (current + 32)));
+
+	low = _mm256_andnot_si256(low, _mm256_loadu_si256((__m256i*) active));
+	high = _mm256_andnot_si256(high, _mm256_loadu_si256((__m256i*) (active + 32)));
+	return ((uint64_t) (uint32_t) _mm256_movemask_epi8(high) << 32) | (uint32_t) _mm256_movemask_epi8(low);
+	#elif defined(MMBACKEND_SSE2)
+	uint64_t bits = 0;
+	size_t u;
+	__m128i equal;
+
+	for(u = 0; u < 4; u++){
+		equal = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i*) (previous + u * 16)), _mm_loadu_si128((__m128i*) (current + u * 16)));
+		equal = _mm_andnot_si128(equal, _mm_loadu_si128((__m128i*) (active + u * 16)));
+		bits |= ((uint64_t) (uint16_t) _mm_movemask_epi8(equal)) << (u * 16);
+	}
+	return bits;
+	#else
+	uint64_t bits = 0, a, b, mask;
+	size_t u, p;
+
+	for(u = 0; u < 64; u += 8){
+		memcpy(&a, previous + u, sizeof(a));
+		memcpy(&b, current + u, sizeof(b));
+		memcpy(&mask, active + u, sizeof(mask));
+		//only inspect single slots if any active slot in this word changed
+		if((a ^ b) & mask){
+			for(p = u; p < u + 8; p++){
+				if(active[p] && previous[p] != current[p]){
+					bits |= ((uint64_t) 1) << p;
+				}
+			}
+		}
+	}
+	return bits;
+	#endif
+}
+
+size_t mmbackend_diff(uint8_t* previous, uint8_t* current, uint8_t* active, uint64_t* changed){
+	size_t u, changes = 0;
+
+	for(u = 0; u < MMBACKEND_DIFF_WORDS; u++){
+		changed[u] = mmbackend_diff_block(previous + u * 64, current + u * 64, active + u * 64);
+		changes += __builtin_popcountll(changed[u]);
+	}
+	return changes;
+}
+
 json_type json_identify(char* json, size_t length){
 	size_t n;
 
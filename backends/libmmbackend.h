@@ -85,6 +85,168 @@ int mmbackend_send(int fd, uint8_t* data, size_t length);
  */
 int mmbackend_send_str(int fd, char* data);
 
+/** Batched datagram reception **/
+
+typedef struct /*_mmbackend_recv_batch*/ {
+	size_t slots;
+	size_t size;
+	//packet data, length and sender address, valid for the packets returned by the last call to mmbackend_recv
+	uint8_t* buffer;
+	size_t* length;
+	struct sockaddr_storage* peer;
+	socklen_t* peer_len;
+	//platform-specific message headers
+	void* headers;
+	//number of system calls and packets received, for reporting
+	uint64_t calls;
+	uint64_t packets;
+} mmbackend_recv_batch;
+
+/*
+ * Allocate a batch of `slots` packet buffers of `size` bytes each.
+ * Returns 0 on success, 1 on failure.
+ */
+int mmbackend_recv_init(mmbackend_recv_batch* batch, size_t slots, size_t size);
+
+/*
+ * Receive up to batch->slots datagrams from a non-blocking socket, using a single
+ * recvmmsg call where available and one recvfrom call per packet elsewhere.
+ * Packet n is stored at batch->buffer + n * batch->size, its length in batch->length[n]
+ * and its sender in batch->peer[n] / batch->peer_len[n]. Datagrams longer than the
+ * buffer size are truncated.
+ * Returns the number of packets received, 0 if no data was pending or -1 on
+ * failure (use mmbackend_socket_strerror to retrieve the error).
+ * Returning a full batch indicates that more data may be pending.
+ */
+ssize_t mmbackend_recv(mmbackend_recv_batch* batch, int fd);
+
+/*
+ * Release all buffers held by a batch.
+ */
+void mmbackend_recv_free(mmbackend_recv_batch* batch);
+
+/** Batched datagram transmission **/
+
+typedef struct /*_mmbackend_send_batch*/ {
+	size_t slots;
+	size_t pending;
+	//queued packets, referenced until the next flush
+	uint8_t** data;
+	size_t* length;
+	struct sockaddr** dest;
+	socklen_t* dest_len;
+	//platform-specific message headers
+	void* headers;
+	//number of system calls and packets sent, for reporting
+	uint64_t calls;
+	uint64_t packets;
+} mmbackend_send_batch;
+
+/*
+ * Allocate a batch for up to `slots` queued packets.
+ * Returns 0 on success, 1 on failure.
+ */
+int mmbackend_send_init(mmbackend_send_batch* batch, size_t slots);
+
+/*
+ * Queue a datagram for transmission. The data is not copied, so the buffer
+ * must remain valid until the next flush and may still be modified until then.
+ * Returns 0 on success, 1 if the batch is full.
+ */
+int mmbackend_send_queue(mmbackend_send_batch* batch, uint8_t* data, size_t length, struct sockaddr* dest, socklen_t dest_len);
+
+/*
+ * Transmit all queued datagrams on a socket, using as few sendmmsg calls as
+ * possible where available and one sendto call per packet elsewhere, and empty
+ * the queue. Returns the number of packets sent, which are always the first
+ * ones queued. If not all packets could be sent, the error of the failing call
+ * is left for mmbackend_socket_strerror.
+ */
+size_t mmbackend_send_flush(mmbackend_send_batch* batch, int fd);
+
+/*
+ * Release all memory held by a batch.
+ */
+void mmbackend_send_free(mmbackend_send_batch* batch);
+
+/** Multi-source universe merging **/
+
+#define MMBACKEND_MERGE_SLOTS 512
+#define MMBACKEND_MERGE_SOURCES 16
+#define MMBACKEND_MERGE_ID 16
+
+typedef enum /*_mmbackend_merge_mode*/ {
+	merge_ltp = 0,
+	merge_htp
+} mmbackend_merge_mode;
+
+typedef struct /*_mmbackend_merge_source*/ {
+	//source identifier (e.g. a CID or sender address), zero-padded
+	uint8_t id[MMBACKEND_MERGE_ID];
+	uint64_t last;
+	uint8_t priority;
+	//set once per-address priorities have been received from this source
+	uint8_t address_priorities;
+	uint8_t data[MMBACKEND_MERGE_SLOTS];
+	uint8_t address_priority[MMBACKEND_MERGE_SLOTS];
+} mmbackend_merge_source;
+
+typedef struct /*_mmbackend_merge*/ {
+	mmbackend_merge_mode mode;
+	//source timeout in milliseconds
+	uint64_t timeout;
+	size_t sources;
+	mmbackend_merge_source* source;
+	//for LTP merging, the source that last changed each slot
+	uint8_t owner[MMBACKEND_MERGE_SLOTS];
+	uint8_t merged[MMBACKEND_MERGE_SLOTS];
+} mmbackend_merge;
+
+/*
+ * Update the slot values of a source and recompute the merged universe in merge->merged.
+ * Sources are created on first contact and expire after merge->timeout milliseconds
+ * without updates (relative to `now`). Slots not driven by any source are 0.
+ * Slots are merged by highest priority first (the per-address priority where
+ * available, otherwise the source priority), then by the configured merge mode.
+ * Returns 0 on success, 1 if the source could not be tracked (source limit reached
+ * or allocation failure), in which case the merged data is unchanged.
+ */
+int mmbackend_merge_update(mmbackend_merge* merge, uint8_t* id, size_t id_len, uint8_t priority, uint8_t* data, size_t length, uint64_t now);
+
+/*
+ * Update the per-address priorities of a source (e.g. sACN start code 0xDD).
+ * A per-address priority of 0 excludes the source from merging that slot.
+ * Returns 0 on success, 1 if the source could not be tracked.
+ */
+int mmbackend_merge_priority(mmbackend_merge* merge, uint8_t* id, size_t id_len, uint8_t* priority, size_t length, uint64_t now);
+
+/*
+ * Remove a source immediately (e.g. on stream termination) and recompute the merged universe.
+ * Removing the last source resets all slots of the merged universe to zero.
+ * Returns 0 if the source was found, 1 otherwise.
+ */
+int mmbackend_merge_remove(mmbackend_merge* merge, uint8_t* id, size_t id_len);
+
+/*
+ * Release all memory held by a merge context.
+ */
+void mmbackend_merge_free(mmbackend_merge* merge);
+
+/** Universe frame differencing **/
+
+#define MMBACKEND_DIFF_SLOTS 512
+#define MMBACKEND_DIFF_WORDS (MMBACKEND_DIFF_SLOTS / 64)
+
+/*
+ * Compare two frames of MMBACKEND_DIFF_SLOTS bytes, considering only slots whose
+ * byte in `active` is 0xFF (all other slots must be 0). Uses AVX2 or SSE2 where
+ * enabled at compile time (unless built with MMBACKEND_NO_SIMD), comparing 8 bytes
+ * at a time otherwise.
+ * Slot n is flagged in bit (n % 64) of changed[n / 64] if it differs.
+ * Returns the number of changed slots.
+ */
+size_t mmbackend_diff(uint8_t* previous, uint8_t* current, uint8_t* active, uint64_t* changed);
+
 
 /** JSON parsing **/
 
@@ -267,7 +267,7 @@ static int lua_callback_sleep(lua_State* interpreter){
 
 static int lua_callback_output(lua_State* interpreter){
 	size_t n = 0;
-	channel_value val;
+	channel_value val = {0};
 	const char* channel_name = NULL;
 	instance* inst = lua_fetch_instance(interpreter);
 	lua_instance_data* data = (lua_instance_data*) inst->impl;
@@ -662,7 +662,7 @@ static int lua_start(size_t n, instance** inst){
 	size_t u, p;
 	lua_instance_data* data = NULL;
 	int default_handler;
-	channel_value v;
+	channel_value v = {0};
 
 	#ifdef LUA_VERSION_NUM
 	DBGPF("Lua backend built with %s (%d)", LUA_VERSION, LUA_VERSION_NUM);
@@ -365,7 +365,7 @@ static int maweb_process_playback(instance* inst, int64_t page, maweb_channel_ty
 	size_t exec_blocks = json_obj_offset(payload, (metatype == 2) ? "executorBlocks" : "bottomButtons"), offset, block = 0, control;
 	int64_t exec_index = json_obj_int(payload, "iExec", 191);
 	ssize_t channel_index;
-	channel_value evt;
+	channel_value evt = {0};
 
 	if(!exec_blocks){
 		if(metatype == 3){
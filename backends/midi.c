@@ -32,10 +32,12 @@ MM_PLUGIN_API int init(){
 		.create = midi_instance,
 		.conf_instance = midi_configure_instance,
 		.channel = midi_channel,
+		.channel_range = midi_channel_range,
 		.handle = midi_set,
 		.process = midi_handle,
 		.start = midi_start,
-		.shutdown = midi_shutdown
+		.shutdown = midi_shutdown,
+		.flags = mmbackend_no_echo
 	};
 
 	if(sizeof(midi_channel_ident) != sizeof(uint64_t)){
@@ -188,6 +190,61 @@ static channel* midi_channel(instance* inst, char* spec, uint8_t flags){
 	return NULL;
 }
 
+static int midi_channel_range(instance* inst, char* prefix, uint64_t first, uint64_t last, char* suffix, uint8_t flags, channel** channels){
+	midi_channel_ident ident = {
+		.label = 0
+	};
+	uint64_t u;
+	char* channel = NULL;
+
+	if(!strncmp(prefix, "ch", 2)){
+		channel = prefix + 2;
+		if(!strncmp(prefix, "channel", 7)){
+			channel = prefix + 7;
+		}
+	}
+
+	//anything unusual is left to the per-channel parser, which reports errors properly
+	if(!channel || *suffix || max(first, last) > 0xFFFF){
+		return 1;
+	}
+
+	ident.fields.channel = strtoul(channel, &channel, 10);
+	if(ident.fields.channel > 15 || *channel != '.'){
+		return 1;
+	}
+	channel++;
+
+	//only control types carrying an index can be ranged over
+	if(!strcmp(channel, "cc")){
+		ident.fields.type = cc;
+	}
+	else if(!strcmp(channel, "note")){
+		ident.fields.type = note;
+	}
+	else if(!strcmp(channel, "pressure")){
+		ident.fields.type = pressure;
+	}
+	else if(!strcmp(channel, "rpn")){
+		ident.fields.type = rpn;
+	}
+	else if(!strcmp(channel, "nrpn")){
+		ident.fields.type = nrpn;
+	}
+	else{
+		return 1;
+	}
+
+	for(u = 0; u <= max(first, last) - min(first, last); u++){
+		ident.fields.control = (first <= last) ? (first + u) : (first - u);
+		channels[u] = mm_channel(inst, ident.label, 1);
+		if(!channels[u]){
+			return 1;
+		}
+	}
+	return 0;
+}
+
 static void midi_tx(int port, uint8_t type, uint8_t channel, uint8_t control, uint16_t value){
 	snd_seq_event_t ev;
 
@@ -289,7 +346,7 @@ static void midi_handle_epn(instance* inst, uint8_t chan, uint16_t control, uint
 		.label = 0
 	};
 	channel* changed = NULL;
-	channel_value val;
+	channel_value val = {0};
 	//check for 3-byte update TODO
 
 	//switching between nrpn and rpn clears all valid bits
@@ -366,7 +423,7 @@ static int midi_handle(size_t num, managed_fd* fds){
 	midi_instance_data* data = NULL;
 
 	channel* changed = NULL;
-	channel_value val;
+	channel_value val = {0};
 
 	char* event_type = NULL;
 	midi_channel_ident ident = {
@@ -386,7 +443,7 @@ static int midi_handle(size_t num, managed_fd* fds){
 		val.normalised = (double) ev->data.note.velocity / 127.0;
 
 		//scan for the instance before parsing incoming data, instance state is required for the EPN state machine
-		inst = mm_instance_find(BACKEND_NAME, ev->dest.port);
+		inst = mm_instance_lookup(fds[0].backend, ev->dest.port);
 		if(!inst){
 			LOG("Delivered event did not match any instance");
 			continue;
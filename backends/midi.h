@@ -5,6 +5,7 @@ static int midi_configure(char* option, char* value);
 static int midi_configure_instance(instance* instance, char* option, char* value);
 static int midi_instance(instance* inst);
 static channel* midi_channel(instance* instance, char* spec, uint8_t flags);
+static int midi_channel_range(instance* instance, char* prefix, uint64_t first, uint64_t last, char* suffix, uint8_t flags, channel** channels);
 static int midi_set(instance* inst, size_t num, channel** c, channel_value* v);
 static int midi_handle(size_t num, managed_fd* fds);
 static int midi_start(size_t n, instance** inst);
@@ -601,7 +601,7 @@ static int mqtt_maintenance(){
 
 static int mqtt_deserialize(instance* inst, channel* output, mqtt_channel_data* input, char* buffer, size_t length){
 	char* next_token = NULL, conversion_buffer[1024] = {0};
-	channel_value val;
+	channel_value val = {0};
 	double range, raw;
 	size_t u;
 	//FIXME implement json subchannels
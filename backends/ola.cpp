@@ -155,7 +155,7 @@ static void ola_data_receive(unsigned int universe, const ola::DmxBuffer& ola_dm
 	uint8_t raw_dmx[dmx_length];
 	uint16_t wide_val;
 	channel* chan = NULL;
-	channel_value val;
+	channel_value val = {0};
 	instance* inst = mm_instance_find(BACKEND_NAME, universe);
 	if(!inst){
 		return;
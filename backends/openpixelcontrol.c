@@ -16,10 +16,12 @@ MM_PLUGIN_API int init(){
 		.create = openpixel_instance,
 		.conf_instance = openpixel_configure_instance,
 		.channel = openpixel_channel,
+		.channel_range = openpixel_channel_range,
 		.handle = openpixel_set,
 		.process = openpixel_handle,
 		.start = openpixel_start,
-		.shutdown = openpixel_shutdown
+		.shutdown = openpixel_shutdown,
+		.flags = mmbackend_no_echo
 	};
 
 	//register backend
@@ -217,6 +219,63 @@ static channel* openpixel_channel(instance* inst, char* spec, uint8_t flags){
 	return mm_channel(inst, ((uint64_t) strip) << 32 | channel, 1);
 }
 
+static int openpixel_channel_range(instance* inst, char* prefix, uint64_t first, uint64_t last, char* suffix, uint8_t flags, channel** channels){
+	uint32_t strip = 0, channel = 0, highest = 0;
+	uint8_t stride = 1, component = 0;
+	uint64_t u;
+	char* token = prefix;
+	openpixel_instance_data* data = (openpixel_instance_data*) inst->impl;
+
+	//read strip index if supplied
+	if(!strncmp(prefix, "strip", 5)){
+		strip = strtoul(prefix + 5, &token, 10);
+		if(*token != '.'){
+			return 1;
+		}
+		token++;
+	}
+
+	//the glob must directly follow the channel type
+	if(!strcmp(token, "red")){
+		stride = 3;
+		component = 2;
+	}
+	else if(!strcmp(token, "green")){
+		stride = 3;
+		component = 1;
+	}
+	else if(!strcmp(token, "blue")){
+		stride = 3;
+	}
+	else if(strcmp(token, "channel")){
+		return 1;
+	}
+
+	//leave anything unusual to the per-channel parser, which reports errors properly
+	if(*suffix || !first || !last
+			|| max(first, last) * stride > 0xFFFF
+			|| ((flags & mmchannel_input) && (!strip || data->listen_fd < 0))
+			|| ((flags & mmchannel_output) && data->dest_fd < 0)){
+		return 1;
+	}
+
+	//size the buffers once for the whole range
+	highest = max(first, last) * stride - component;
+	if(((flags & mmchannel_input) && openpixel_buffer_extend(data, strip, 1, highest))
+			|| ((flags & mmchannel_output) && openpixel_buffer_extend(data, strip, 0, highest))){
+		return 1;
+	}
+
+	for(u = 0; u <= max(first, last) - min(first, last); u++){
+		channel = ((first <= last) ? (first + u) : (first - u)) * stride - component;
+		channels[u] = mm_channel(inst, ((uint64_t) strip) << 32 | channel, 1);
+		if(!channels[u]){
+			return 1;
+		}
+	}
+	return 0;
+}
+
 static int openpixel_output_data(openpixel_instance_data* data){
 	size_t u;
 	openpixel_header hdr;
@@ -342,7 +401,7 @@ static int openpixel_client_new(instance* inst, int fd){
 
 static size_t openpixel_strip_pixeldata8(instance* inst, openpixel_client* client, uint8_t* data, openpixel_buffer* buffer, size_t bytes_left){
 	channel* chan = NULL;
-	channel_value val;
+	channel_value val = {0};
 	size_t u;
 
 	for(u = 0; u < bytes_left; u++){
@@ -373,7 +432,7 @@ static size_t openpixel_strip_pixeldata8(instance* inst, openpixel_client* clien
 
 static size_t openpixel_strip_pixeldata16(instance* inst, openpixel_client* client, uint8_t* data, openpixel_buffer* buffer, size_t bytes_left){
 	channel* chan = NULL;
-	channel_value val;
+	channel_value val = {0};
 	size_t u;
 
 	for(u = 0; u < bytes_left; u++){
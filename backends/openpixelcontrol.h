@@ -5,6 +5,7 @@ static int openpixel_configure(char* option, char* value);
 static int openpixel_configure_instance(instance* inst, char* option, char* value);
 static int openpixel_instance(instance* inst);
 static channel* openpixel_channel(instance* inst, char* spec, uint8_t flags);
+static int openpixel_channel_range(instance* inst, char* prefix, uint64_t first, uint64_t last, char* suffix, uint8_t flags, channel** channels);
 static int openpixel_set(instance* inst, size_t num, channel** c, channel_value* v);
 static int openpixel_handle(size_t num, managed_fd* fds);
 static int openpixel_start(size_t n, instance** inst);
@@ -770,7 +770,7 @@ static int osc_process_message(instance* inst, char* local_path, char* format, u
 	osc_instance_data* data = (osc_instance_data*) inst->impl;
 	size_t c, p, offset = 0;
 	osc_parameter_value min, max, cur;
-	channel_value evt;
+	channel_value evt = {0};
 	osc_channel_ident ident = {
 		.label = 0
 	};
@@ -697,7 +697,7 @@ static PyObject* python_resolve_symbol(char* spec_raw){
 static int python_start(size_t n, instance** inst){
 	python_instance_data* data = NULL;
 	size_t u, p;
-	channel_value v;
+	channel_value v = {0};
 
 	//resolve channel references to handler functions
 	for(u = 0; u < n; u++){
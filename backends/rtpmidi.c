@@ -88,7 +88,8 @@ MM_PLUGIN_API int init(){
 		.interval = rtpmidi_interval,
 		.process = rtpmidi_handle,
 		.start = rtpmidi_start,
-		.shutdown = rtpmidi_shutdown
+		.shutdown = rtpmidi_shutdown,
+		.flags = mmbackend_no_echo
 	};
 
 	if(sizeof(rtpmidi_channel_ident) != sizeof(uint64_t)){
@@ -1008,7 +1009,7 @@ static void rtpmidi_handle_epn(instance* inst, uint8_t chan, uint16_t control, u
 		.label = 0
 	};
 	channel* changed = NULL;
-	channel_value val;
+	channel_value val = {0};
 
 	//switching between nrpn and rpn clears all valid bits
 	if(((data->epn_status[chan] & EPN_NRPN) && (control == 101 || control == 100))
@@ -1080,7 +1081,7 @@ static int rtpmidi_parse(instance* inst, uint8_t* frame, size_t bytes){
 	size_t offset = 1, decode_time = 0, command_bytes = 0;
 	uint8_t midi_status = 0;
 	rtpmidi_channel_ident ident;
-	channel_value val;
+	channel_value val = {0};
 	channel* chan = NULL;
 
 	if(!bytes){
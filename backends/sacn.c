@@ -27,16 +27,21 @@ static struct /*_sacn_global_config*/ {
 	uint8_t cid[16];
 	size_t fds;
 	sacn_fd* fd;
-	uint64_t last_announce;
-	uint32_t next_frame;
+	mmbackend_recv_batch batch;
+	uint64_t flush_timer;
+	uint8_t flush_armed;
+	uint64_t discovery_timer;
 	uint8_t detect;
+	uint16_t sync;
+	uint64_t last_sync;
+	sacn_sync_pdu sync_frame;
+	struct sockaddr_in sync_dest;
 } global_cfg = {
 	.source_name = "MIDIMonster",
 	.cid = {'M', 'I', 'D', 'I', 'M', 'o', 'n', 's', 't', 'e', 'r'},
 	.fds = 0,
 	.fd = NULL,
-	.last_announce = 0,
-	.next_frame = 0,
+	.discovery_timer = 0,
 	.detect = 0
 };
 
@@ -47,10 +52,10 @@ MM_PLUGIN_API int init(){
 		.create = sacn_instance,
 		.conf_instance = sacn_configure_instance,
 		.channel = sacn_channel,
+		.channel_range = sacn_channel_range,
 		.handle = sacn_set,
 		.process = sacn_handle,
 		.start = sacn_start,
-		.interval = sacn_interval,
 		.shutdown = sacn_shutdown
 	};
 
@@ -68,13 +73,6 @@ MM_PLUGIN_API int init(){
 	return 0;
 }
 
-static uint32_t sacn_interval(){
-	if(global_cfg.next_frame){
-		return global_cfg.next_frame;
-	}
-	return SACN_KEEPALIVE_INTERVAL;
-}
-
 static int sacn_listener(char* host, char* port, uint8_t flags){
 	int fd = -1, yes = 1;
 	if(global_cfg.fds >= MAX_FDS){
@@ -99,6 +97,8 @@ static int sacn_listener(char* host, char* port, uint8_t flags){
 	global_cfg.fd[global_cfg.fds].fd = fd;
 	global_cfg.fd[global_cfg.fds].universes = 0;
 	global_cfg.fd[global_cfg.fds].universe = NULL;
+	global_cfg.fd[global_cfg.fds].queued = NULL;
+	memset(&global_cfg.fd[global_cfg.fds].batch, 0, sizeof(global_cfg.fd[global_cfg.fds].batch));
 
 	if(flags & mcast_loop){
 		//set IP_MCAST_LOOP to allow local applications to receive output
@@ -142,6 +142,15 @@ static int sacn_configure(char* option, char* value){
 		}
 		return 0;
 	}
+	else if(!strcmp(option, "sync")){
+		global_cfg.sync = strtoul(value, NULL, 10);
+		if(global_cfg.sync > SACN_MAX_UNIVERSE){
+			LOGPF("Invalid synchronization universe %s", value);
+			global_cfg.sync = 0;
+			return 1;
+		}
+		return 0;
+	}
 	else if(!strcmp(option, "bind")){
 		mmbackend_parse_hostspec(value, &host, &port, &next);
 
@@ -220,6 +229,19 @@ static int sacn_configure_instance(instance* inst, char* option, char* value){
 		data->realtime = strtoul(value, NULL, 10);
 		return 0;
 	}
+	else if(!strcmp(option, "merge")){
+		if(!strcmp(value, "htp")){
+			data->data.merge.mode = merge_htp;
+		}
+		else if(!strcmp(value, "ltp")){
+			data->data.merge.mode = merge_ltp;
+		}
+		else{
+			LOGPF("Unknown merge mode %s on instance %s", value, inst->name);
+			return 1;
+		}
+		return 0;
+	}
 
 	LOGPF("Unknown instance configuration option %s for instance %s", option, inst->name);
 	return 1;
@@ -234,6 +256,9 @@ static int sacn_instance(instance* inst){
 		return 1;
 	}
 
+	//the first slot of the frame data carries the start code
+	data->data.out = data->data.frame.data.data + 1;
+	data->data.merge.timeout = SACN_SOURCE_TIMEOUT;
 	for(u = 0; u < sizeof(data->data.channel) / sizeof(channel); u++){
 		data->data.channel[u].ident = u;
 		data->data.channel[u].instance = inst;
@@ -292,64 +317,187 @@ static channel* sacn_channel(instance* inst, char* spec, uint8_t flags){
 	return data->data.channel + chan_a;
 }
 
+static int sacn_channel_range(instance* inst, char* prefix, uint64_t first, uint64_t last, char* suffix, uint8_t flags, channel** channels){
+	sacn_instance_data* data = (sacn_instance_data*) inst->impl;
+	uint64_t u, chan;
+
+	//only plain channel ranges are handled here, everything else is parsed per channel
+	if(*prefix || *suffix
+			|| !first || first > 512
+			|| !last || last > 512){
+		return 1;
+	}
+
+	//check output capabilities
+	if((flags & mmchannel_output) && !data->xmit_prio){
+		LOGPF("Channels %s.{%" PRIu64 "..%" PRIu64 "} mapped for output, but instance is not configured for output (no priority set)", inst->name, first, last);
+	}
+
+	for(u = 0; u <= max(first, last) - min(first, last); u++){
+		chan = ((first <= last) ? (first + u) : (first - u)) - 1;
+
+		//let the per-channel parser report mapping conflicts
+		if(IS_ACTIVE(data->data.map[chan]) && data->data.map[chan] != (MAP_SINGLE | chan)){
+			return 1;
+		}
+
+		data->data.map[chan] = MAP_SINGLE | chan;
+		channels[u] = data->data.channel + chan;
+	}
+	return 0;
+}
+
+static void sacn_frame_prepare(sacn_instance_data* data){
+	sacn_data_pdu* pdu = &data->data.frame;
+
+	//static parts of the output frame, channel data and the sequence number are updated in place
+	pdu->root.preamble_size = htobe16(0x10);
+	pdu->root.postamble_size = 0;
+	memcpy(pdu->root.magic, SACN_PDU_MAGIC, sizeof(pdu->root.magic));
+	pdu->root.flags = htobe16(0x7000 | 0x026e);
+	pdu->root.vector = htobe32(ROOT_E131_DATA);
+	memcpy(pdu->root.sender_cid, global_cfg.cid, sizeof(pdu->root.sender_cid));
+	pdu->root.frame_flags = htobe16(0x7000 | 0x0258);
+	pdu->root.frame_vector = htobe32(FRAME_E131_DATA);
+
+	memcpy(pdu->data.source_name, global_cfg.source_name, sizeof(pdu->data.source_name));
+	pdu->data.priority = data->xmit_prio;
+	pdu->data.sync_addr = htobe16(global_cfg.sync);
+	pdu->data.options = 0;
+	pdu->data.universe = htobe16(data->uni);
+	pdu->data.flags = htobe16(0x7000 | 0x020b);
+	pdu->data.vector = DMP_SET_PROPERTY;
+	pdu->data.format = 0xA1;
+	pdu->data.startcode_offset = 0;
+	pdu->data.address_increment = htobe16(1);
+	pdu->data.channels = htobe16(513);
+	pdu->data.data[0] = 0;
+}
+
+static void sacn_sync_prepare(){
+	sacn_sync_pdu* pdu = &global_cfg.sync_frame;
+
+	pdu->root.preamble_size = htobe16(0x10);
+	pdu->root.postamble_size = 0;
+	memcpy(pdu->root.magic, SACN_PDU_MAGIC, sizeof(pdu->root.magic));
+	pdu->root.flags = htobe16(0x7000 | (sizeof(sacn_sync_pdu) - 16));
+	pdu->root.vector = htobe32(ROOT_E131_EXTENDED);
+	memcpy(pdu->root.sender_cid, global_cfg.cid, sizeof(pdu->root.sender_cid));
+	pdu->root.frame_flags = htobe16(0x7000 | (sizeof(sacn_sync_pdu) - 38));
+	pdu->root.frame_vector = htobe32(FRAME_E131_SYNC);
+	pdu->data.sequence = 0;
+	pdu->data.sync_addr = htobe16(global_cfg.sync);
+
+	//multicast output is synchronized via the multicast group of the synchronization universe
+	global_cfg.sync_dest.sin_family = AF_INET;
+	global_cfg.sync_dest.sin_port = htobe16(strtoul(SACN_PORT, NULL, 10));
+	global_cfg.sync_dest.sin_addr.s_addr = htobe32(((uint32_t) 0xefff0000) | ((uint32_t) global_cfg.sync));
+}
+
 static int sacn_transmit(instance* inst, sacn_output_universe* output){
 	sacn_instance_data* data = (sacn_instance_data*) inst->impl;
+	sacn_fd* fd = global_cfg.fd + data->fd_index;
+	uint32_t frame_delta = 0;
 
-	//build sacn frame
-	sacn_data_pdu pdu = {
-		.root = {
-			.preamble_size = htobe16(0x10),
-			.postamble_size = 0,
-			.magic = { 0 }, //memcpy'd
-			.flags = htobe16(0x7000 | 0x026e),
-			.vector = htobe32(ROOT_E131_DATA),
-			.sender_cid = { 0 }, //memcpy'd
-			.frame_flags = htobe16(0x7000 | 0x0258),
-			.frame_vector = htobe32(FRAME_E131_DATA)
-		},
-		.data = {
-			.source_name = "", //memcpy'd
-			.priority = data->xmit_prio,
-			.sync_addr = 0,
-			.sequence = data->data.last_seq++,
-			.options = 0,
-			.universe = htobe16(data->uni),
-			.flags = htobe16(0x7000 | 0x020b),
-			.vector = DMP_SET_PROPERTY,
-			.format = 0xA1,
-			.startcode_offset = 0,
-			.address_increment = htobe16(1),
-			.channels = htobe16(513),
-			.data = { 0 } //memcpy'd
+	//schedule next keepalive frame
+	mm_timer_update(output->timer, SACN_KEEPALIVE_INTERVAL);
+
+	//a queued frame is read on flush and already contains any later changes
+	if(output->queued){
+		return 0;
+	}
+
+	//the batch has a slot for every output universe on the socket
+	data->data.frame.data.sequence = data->data.last_seq++;
+	fd->queued[fd->batch.pending] = output;
+	mmbackend_send_queue(&fd->batch, (uint8_t*) &data->data.frame, sizeof(sacn_data_pdu), (struct sockaddr*) &data->dest_addr, data->dest_len);
+	output->queued = 1;
+
+	//send all frames queued in this iteration together at the start of the next one
+	if(!global_cfg.flush_armed){
+		global_cfg.flush_armed = 1;
+		//synchronized output is rate limited as a whole
+		frame_delta = mm_timestamp() - global_cfg.last_sync;
+		mm_timer_update(global_cfg.flush_timer, (global_cfg.sync && frame_delta < SACN_FRAME_TIMEOUT) ? (SACN_FRAME_TIMEOUT - frame_delta) : 0);
+	}
+	return 0;
+}
+
+static void sacn_queue_sync(sacn_fd* fd){
+	size_t p, d, queued = fd->batch.pending;
+	sacn_instance_data* data = NULL;
+	struct sockaddr* dest = NULL;
+	socklen_t dest_len = 0;
+
+	//follow the frames with one synchronization packet per distinct destination
+	for(p = 0; p < queued; p++){
+		data = (sacn_instance_data*) fd->queued[p]->inst->impl;
+		dest = (struct sockaddr*) &data->dest_addr;
+		dest_len = data->dest_len;
+		if(dest->sa_family == AF_INET && (be32toh(((struct sockaddr_in*) dest)->sin_addr.s_addr) & 0xF0000000) == 0xE0000000){
+			dest = (struct sockaddr*) &global_cfg.sync_dest;
+			dest_len = sizeof(global_cfg.sync_dest);
 		}
-	};
 
-	memcpy(pdu.root.magic, SACN_PDU_MAGIC, sizeof(pdu.root.magic));
-	memcpy(pdu.root.sender_cid, global_cfg.cid, sizeof(pdu.root.sender_cid));
-	memcpy(pdu.data.source_name, global_cfg.source_name, sizeof(pdu.data.source_name));
-	memcpy((((uint8_t*)pdu.data.data) + 1), data->data.out, 512);
+		for(d = queued; d < fd->batch.pending; d++){
+			if(fd->batch.dest_len[d] == dest_len && !memcmp(fd->batch.dest[d], dest, dest_len)){
+				break;
+			}
+		}
 
-	if(sendto(global_cfg.fd[data->fd_index].fd, (uint8_t*) &pdu, sizeof(pdu), 0, (struct sockaddr*) &data->dest_addr, data->dest_len) < 0){
-		#ifdef _WIN32
-		if(WSAGetLastError() != WSAEWOULDBLOCK){
-		#else
-		if(errno != EAGAIN){
-		#endif
-			LOGPF("Failed to output frame for instance %s: %s", inst->name, mmbackend_socket_strerror(errno));
-			return 1;
+		if(d == fd->batch.pending){
+			mmbackend_send_queue(&fd->batch, (uint8_t*) &global_cfg.sync_frame, sizeof(sacn_sync_pdu), dest, dest_len);
 		}
+	}
+}
+
+static int sacn_flush(uint64_t timer, void* impl){
+	size_t u, p, queued, total, sent;
+	sacn_fd* fd = NULL;
 
-		//reschedule output
-		output->mark = 1;
-		if(!global_cfg.next_frame || global_cfg.next_frame > SACN_SYNTHESIZE_MARGIN){
-			global_cfg.next_frame = SACN_SYNTHESIZE_MARGIN;
+	global_cfg.flush_armed = 0;
+	for(u = 0; u < global_cfg.fds; u++){
+		fd = global_cfg.fd + u;
+		if(!fd->batch.pending){
+			continue;
+		}
+
+		queued = fd->batch.pending;
+		if(global_cfg.sync){
+			global_cfg.sync_frame.data.sequence++;
+			sacn_queue_sync(fd);
+		}
+
+		total = fd->batch.pending;
+		sent = mmbackend_send_flush(&fd->batch, fd->fd);
+		if(sent < total){
+			#ifdef _WIN32
+			if(WSAGetLastError() != WSAEWOULDBLOCK){
+			#else
+			if(errno != EAGAIN){
+			#endif
+				LOGPF("Failed to output %" PRIsize_t " frames on socket %" PRIsize_t ": %s", total - sent, u, mmbackend_socket_strerror(errno));
+			}
+		}
+
+		for(p = 0; p < queued; p++){
+			fd->queued[p]->queued = 0;
+			if(p < sent){
+				//update last transmit timestamp, unmark instance
+				fd->queued[p]->last_frame = mm_timestamp();
+				fd->queued[p]->mark = 0;
+			}
+			else{
+				//reschedule output
+				fd->queued[p]->mark = 1;
+				mm_timer_update(fd->queued[p]->timer, SACN_SYNTHESIZE_MARGIN);
+			}
 		}
-		return 0;
 	}
 
-	//update last transmit timestamp, unmark instance
-	output->last_frame = mm_timestamp();
-	output->mark = 0;
+	if(global_cfg.sync){
+		global_cfg.last_sync = mm_timestamp();
+	}
 	return 0;
 }
 
@@ -392,14 +540,15 @@ static int sacn_set(instance* inst, size_t num, channel** c, channel_value* v){
 			}
 		}
 
-		if(!data->realtime){
+		//synchronized output is rate limited per frame across all universes when flushing
+		if(!data->realtime && !global_cfg.sync){
 			frame_delta = mm_timestamp() - global_cfg.fd[data->fd_index].universe[u].last_frame;
 
-			//check if ratelimiting engaged
+			//check if ratelimiting engaged, schedule next frame
 			if(frame_delta < SACN_FRAME_TIMEOUT){
-				global_cfg.fd[data->fd_index].universe[u].mark = 1;
-				if(!global_cfg.next_frame || global_cfg.next_frame > (SACN_FRAME_TIMEOUT - frame_delta)){
-					global_cfg.next_frame = (SACN_FRAME_TIMEOUT - frame_delta);
+				if(!global_cfg.fd[data->fd_index].universe[u].mark){
+					global_cfg.fd[data->fd_index].universe[u].mark = 1;
+					mm_timer_update(global_cfg.fd[data->fd_index].universe[u].timer, SACN_FRAME_TIMEOUT - frame_delta);
 				}
 				return 0;
 			}
@@ -411,9 +560,10 @@ static int sacn_set(instance* inst, size_t num, channel** c, channel_value* v){
 }
 
 static int sacn_process_frame(instance* inst, sacn_frame_root* frame, sacn_frame_data* data){
-	size_t u, max_mark = 0;
+	size_t u, w, partner, channels = be16toh(data->channels);
+	uint64_t changed[MMBACKEND_DIFF_WORDS];
 	channel* chan = NULL;
-	channel_value val;
+	channel_value val = {0};
 	sacn_instance_data* inst_data = (sacn_instance_data*) inst->impl;
 
 	//source filtering
@@ -431,41 +581,62 @@ static int sacn_process_frame(instance* inst, sacn_frame_root* frame, sacn_frame
 		return 1;
 	}
 
-	if(be16toh(data->channels) > 513){
-		LOGPF("Invalid frame channel count %d on instance %s", be16toh(data->channels), inst->name);
+	if(channels > 513){
+		LOGPF("Invalid frame channel count %" PRIsize_t " on instance %s", channels, inst->name);
 		return 1;
 	}
 
-	//handle source priority (currently a 1-bit counter)
-	if(inst_data->data.last_priority > data->priority){
-		if(global_cfg.detect > 1){
-			LOGPF("Ignoring lower-priority (%d) source on %s, current source is %d", data->priority, inst->name, inst_data->data.last_priority);
+	//sources leaving the universe are dropped from the merge immediately
+	if(data->options & OPTION_TERMINATED){
+		if(mmbackend_merge_remove(&inst_data->data.merge, frame->sender_cid, sizeof(frame->sender_cid))){
+			return 0;
 		}
-		inst_data->data.last_priority = data->priority;
-		return 0;
-	}
-	inst_data->data.last_priority = data->priority;
 
-	if(!inst_data->last_input && global_cfg.detect){
-		LOGPF("Valid data on instance %s (Universe %u): Source name %.*s, priority %d", inst->name, inst_data->uni, 64, data->source_name, data->priority);
+		if(global_cfg.detect){
+			LOGPF("Source %.*s terminated its stream on instance %s", 64, data->source_name, inst->name);
+		}
 	}
-	inst_data->last_input = mm_timestamp();
+	else if(channels && data->data[0] == STARTCODE_PRIORITY){
+		//per-address priorities, as sent by some consoles with start code 0xDD
+		if(mmbackend_merge_priority(&inst_data->data.merge, frame->sender_cid, sizeof(frame->sender_cid), data->data + 1, channels - 1, mm_timestamp())){
+			if(global_cfg.detect > 1){
+				LOGPF("Source limit reached on instance %s, ignoring %.*s", inst->name, 64, data->source_name);
+			}
+			return 0;
+		}
+	}
+	else if(channels && data->data[0] == STARTCODE_DMX){
+		if(!inst_data->last_input && global_cfg.detect){
+			LOGPF("Valid data on instance %s (Universe %u): Source name %.*s, priority %d", inst->name, inst_data->uni, 64, data->source_name, data->priority);
+		}
+		inst_data->last_input = mm_timestamp();
 
-	//read data (except start code), mark changed channels
-	for(u = 1; u < be16toh(data->channels); u++){
-		if(IS_ACTIVE(inst_data->data.map[u - 1])
-				&& data->data[u] != inst_data->data.in[u - 1]){
-			inst_data->data.in[u - 1] = data->data[u];
-			inst_data->data.map[u - 1] |= MAP_MARK;
-			max_mark = u - 1;
+		if(mmbackend_merge_update(&inst_data->data.merge, frame->sender_cid, sizeof(frame->sender_cid), data->priority, data->data + 1, channels - 1, inst_data->last_input)){
+			if(global_cfg.detect > 1){
+				LOGPF("Source limit reached on instance %s, ignoring %.*s", inst->name, 64, data->source_name);
+			}
+			return 0;
 		}
 	}
+	else{
+		if(global_cfg.detect > 1){
+			LOGPF("Ignoring frame with unsupported start code on instance %s", inst->name);
+		}
+		return 0;
+	}
+
+	//only channels whose merged value changed generate events
+	if(!mmbackend_diff(inst_data->data.in, inst_data->data.merge.merged, inst_data->data.active, changed)){
+		return 0;
+	}
+	memcpy(inst_data->data.in, inst_data->data.merge.merged, sizeof(inst_data->data.in));
 
 	//generate events
-	for(u = 0; u <= max_mark; u++){
-		if(inst_data->data.map[u] & MAP_MARK){
-			//unmark and get channel
-			inst_data->data.map[u] &= ~MAP_MARK;
+	for(w = 0; w < MMBACKEND_DIFF_WORDS; w++){
+		while(changed[w]){
+			u = w * 64 + __builtin_ctzll(changed[w]);
+			changed[w] &= changed[w] - 1;
+
 			chan = inst_data->data.channel + u;
 			if(inst_data->data.map[u] & MAP_FINE){
 				chan = inst_data->data.channel + MAPPED_CHANNEL(inst_data->data.map[u]);
@@ -473,9 +644,11 @@ static int sacn_process_frame(instance* inst, sacn_frame_root* frame, sacn_frame
 
 			//generate value
 			if(IS_WIDE(inst_data->data.map[u])){
-				inst_data->data.map[MAPPED_CHANNEL(inst_data->data.map[u])] &= ~MAP_MARK;
+				//the event covers both halves of a wide channel
+				partner = MAPPED_CHANNEL(inst_data->data.map[u]);
+				changed[partner / 64] &= ~(((uint64_t) 1) << (partner % 64));
 				val.raw.u64 = (uint16_t) (inst_data->data.in[u] << ((inst_data->data.map[u] & MAP_COARSE) ? 8 : 0));
-				val.raw.u64 |= (uint16_t) (inst_data->data.in[MAPPED_CHANNEL(inst_data->data.map[u])] << ((inst_data->data.map[u] & MAP_COARSE) ? 0 : 8));
+				val.raw.u64 |= (uint16_t) (inst_data->data.in[partner] << ((inst_data->data.map[u] & MAP_COARSE) ? 0 : 8));
 				val.normalised = (double) val.raw.u64 / (double) 0xFFFF;
 			}
 			else{
@@ -546,59 +719,47 @@ static void sacn_discovery(size_t fd){
 	}
 }
 
-static int sacn_handle(size_t num, managed_fd* fds){
-	size_t u, c;
-	uint64_t timestamp = mm_timestamp();
-	uint32_t synthesize_delta = 0;
-	ssize_t bytes_read;
-	char recv_buf[SACN_RECV_BUF];
-	instance* inst = NULL;
-	sacn_instance_id instance_id = {
-		.label = 0
-	};
-	sacn_frame_root* frame = (sacn_frame_root*) recv_buf;
-	sacn_frame_data* data = (sacn_frame_data*) (recv_buf + sizeof(sacn_frame_root));
-
-	if(timestamp - global_cfg.last_announce > SACN_DISCOVERY_TIMEOUT){
-		//send universe discovery pdu
-		for(u = 0; u < global_cfg.fds; u++){
-			if(global_cfg.fd[u].universes){
-				sacn_discovery(u);
-			}
+static int sacn_discovery_timer(uint64_t timer, void* impl){
+	size_t u;
+
+	//send universe discovery pdu
+	for(u = 0; u < global_cfg.fds; u++){
+		if(global_cfg.fd[u].universes){
+			sacn_discovery(u);
 		}
-		global_cfg.last_announce = timestamp;
 	}
+	return 0;
+}
 
-	//check for keepalive frames, synthesize frames if necessary
-	global_cfg.next_frame = 0;
-	for(u = 0; u < global_cfg.fds; u++){
-		for(c = 0; c < global_cfg.fd[u].universes; c++){
-			synthesize_delta = timestamp - global_cfg.fd[u].universe[c].last_frame;
-
-			if((global_cfg.fd[u].universe[c].mark
-						&& synthesize_delta >= SACN_FRAME_TIMEOUT + SACN_SYNTHESIZE_MARGIN)
-					|| synthesize_delta >= SACN_KEEPALIVE_INTERVAL){
-				instance_id.fields.fd_index = u;
-				instance_id.fields.uni = global_cfg.fd[u].universe[c].universe;
-				inst = mm_instance_find(BACKEND_NAME, instance_id.label);
-				if(inst){
-					sacn_transmit(inst, global_cfg.fd[u].universe + c);
-				}
-			}
+static int sacn_output_timer(uint64_t timer, void* impl){
+	sacn_output_universe* output = (sacn_output_universe*) impl;
 
-			//update next frame request
-			if(global_cfg.fd[u].universe[c].mark
-					&& (!global_cfg.next_frame || global_cfg.next_frame > SACN_FRAME_TIMEOUT + SACN_SYNTHESIZE_MARGIN - synthesize_delta)){
-				global_cfg.next_frame = SACN_FRAME_TIMEOUT + SACN_SYNTHESIZE_MARGIN - synthesize_delta;
-			}
+	//keepalive or rate-limited frame due
+	sacn_transmit(output->inst, output);
+	return 0;
+}
 
-		}
-	}
+static int sacn_handle(size_t num, managed_fd* fds){
+	size_t u;
+	ssize_t packets, p;
+	instance* inst = NULL;
+	sacn_instance_id instance_id = {
+		.label = 0
+	};
+	sacn_frame_root* frame = NULL;
+	sacn_frame_data* data = NULL;
 
 	for(u = 0; u < num; u++){
+		//a full batch indicates that more packets may be pending
 		do{
-			bytes_read = recv(fds[u].fd, recv_buf, sizeof(recv_buf), 0);
-			if(bytes_read > 0 && bytes_read > sizeof(sacn_frame_root)){
+			packets = mmbackend_recv(&global_cfg.batch, fds[u].fd);
+			for(p = 0; p < packets; p++){
+				frame = (sacn_frame_root*) (global_cfg.batch.buffer + p * global_cfg.batch.size);
+				data = (sacn_frame_data*) (global_cfg.batch.buffer + p * global_cfg.batch.size + sizeof(sacn_frame_root));
+				if(global_cfg.batch.length[p] <= sizeof(sacn_frame_root)){
+					continue;
+				}
+
 				if(!memcmp(frame->magic, SACN_PDU_MAGIC, 12)
 						&& be16toh(frame->preamble_size) == 0x10
 						&& frame->postamble_size == 0
@@ -607,7 +768,7 @@ static int sacn_handle(size_t num, managed_fd* fds){
 						&& data->vector == DMP_SET_PROPERTY){
 					instance_id.fields.fd_index = ((uint64_t) fds[u].impl) & 0xFFFF;
 					instance_id.fields.uni = be16toh(data->universe);
-					inst = mm_instance_find(BACKEND_NAME, instance_id.label);
+					inst = mm_instance_lookup(fds[u].backend, instance_id.label);
 					if(inst && sacn_process_frame(inst, frame, data)){
 						LOG("Failed to process frame");
 					}
@@ -617,20 +778,11 @@ static int sacn_handle(size_t num, managed_fd* fds){
 					}
 				}
 			}
-		} while(bytes_read > 0);
+		} while(packets == global_cfg.batch.slots);
 
-		#ifdef _WIN32
-		if(bytes_read < 0 && WSAGetLastError() != WSAEWOULDBLOCK){
-		#else
-		if(bytes_read < 0 && errno != EAGAIN){
-		#endif
+		if(packets < 0){
 			LOGPF("Failed to receive data: %s", mmbackend_socket_strerror(errno));
 		}
-
-		if(bytes_read == 0){
-			LOG("Listener closed");
-			return 1;
-		}
 	}
 
 	return 0;
@@ -695,6 +847,14 @@ static int sacn_start(size_t n, instance** inst){
 		return 1;
 	}
 
+	if(mmbackend_recv_init(&global_cfg.batch, SACN_RECV_BATCH, SACN_RECV_BUF)){
+		return 1;
+	}
+
+	if(global_cfg.sync){
+		sacn_sync_prepare();
+	}
+
 	//update instance identifiers, join multicast groups
 	for(u = 0; u < n; u++){
 		data = (sacn_instance_data*) inst[u]->impl;
@@ -715,6 +875,11 @@ static int sacn_start(size_t n, instance** inst){
 			}
 		}
 
+		//precompute the input slot mask
+		for(p = 0; p < sizeof(data->data.active); p++){
+			data->data.active[p] = IS_ACTIVE(data->data.map[p]) ? 0xFF : 0;
+		}
+
 		if(!data->unicast_input && sacn_start_multicast(inst[u])){
 			return 1;
 		}
@@ -728,9 +893,13 @@ static int sacn_start(size_t n, instance** inst){
 			}
 
 			global_cfg.fd[data->fd_index].universe[global_cfg.fd[data->fd_index].universes].universe = data->uni;
+			global_cfg.fd[data->fd_index].universe[global_cfg.fd[data->fd_index].universes].inst = inst[u];
+			global_cfg.fd[data->fd_index].universe[global_cfg.fd[data->fd_index].universes].timer = 0;
 			global_cfg.fd[data->fd_index].universe[global_cfg.fd[data->fd_index].universes].last_frame = 0;
 			global_cfg.fd[data->fd_index].universe[global_cfg.fd[data->fd_index].universes].mark = 0;
+			global_cfg.fd[data->fd_index].universe[global_cfg.fd[data->fd_index].universes].queued = 0;
 			global_cfg.fd[data->fd_index].universes++;
+			sacn_frame_prepare(data);
 
 			//generate multicast destination address if none set
 			if(!data->dest_len){
@@ -748,6 +917,39 @@ static int sacn_start(size_t n, instance** inst){
 		if(mm_manage_fd(global_cfg.fd[u].fd, BACKEND_NAME, 1, (void*) u)){
 			goto bail;
 		}
+
+		if(global_cfg.fd[u].universes){
+			global_cfg.fd[u].queued = calloc(global_cfg.fd[u].universes, sizeof(sacn_output_universe*));
+			if(!global_cfg.fd[u].queued){
+				LOG("Failed to allocate memory");
+				goto bail;
+			}
+
+			//in synchronized mode, each frame may be followed by a synchronization packet to a separate destination
+			if(mmbackend_send_init(&global_cfg.fd[u].batch, global_cfg.fd[u].universes * (global_cfg.sync ? 2 : 1))){
+				goto bail;
+			}
+		}
+
+		//start output timers, the first frame is sent immediately
+		for(p = 0; p < global_cfg.fd[u].universes; p++){
+			global_cfg.fd[u].universe[p].timer = mm_timer_add(BACKEND_NAME, 0, 0, sacn_output_timer, global_cfg.fd[u].universe + p);
+			if(!global_cfg.fd[u].universe[p].timer){
+				goto bail;
+			}
+		}
+	}
+
+	//frames queued during an iteration are sent by a timer firing at the start of the next one
+	global_cfg.flush_timer = mm_timer_add(BACKEND_NAME, 0, 0, sacn_flush, NULL);
+	if(!global_cfg.flush_timer){
+		goto bail;
+	}
+
+	//periodically announce output universes
+	global_cfg.discovery_timer = mm_timer_add(BACKEND_NAME, 0, SACN_DISCOVERY_TIMEOUT, sacn_discovery_timer, NULL);
+	if(!global_cfg.discovery_timer){
+		goto bail;
 	}
 
 	rv = 0;
@@ -756,17 +958,45 @@ bail:
 }
 
 static int sacn_shutdown(size_t n, instance** inst){
-	size_t p;
+	size_t p, u;
+	uint64_t packets = 0, calls = 0;
 
 	for(p = 0; p < n; p++){
+		mmbackend_merge_free(&((sacn_instance_data*) inst[p]->impl)->data.merge);
 		free(inst[p]->impl);
 	}
 
+	mm_timer_cancel(global_cfg.discovery_timer);
+	if(global_cfg.flush_timer){
+		mm_timer_cancel(global_cfg.flush_timer);
+	}
+	global_cfg.flush_timer = 0;
+	global_cfg.flush_armed = 0;
+	global_cfg.last_sync = 0;
+
 	for(p = 0; p < global_cfg.fds; p++){
 		close(global_cfg.fd[p].fd);
+		for(u = 0; u < global_cfg.fd[p].universes; u++){
+			mm_timer_cancel(global_cfg.fd[p].universe[u].timer);
+		}
 		free(global_cfg.fd[p].universe);
+
+		packets += global_cfg.fd[p].batch.packets;
+		calls += global_cfg.fd[p].batch.calls;
+		mmbackend_send_free(&global_cfg.fd[p].batch);
+		free(global_cfg.fd[p].queued);
 	}
 	free(global_cfg.fd);
+
+	if(calls){
+		LOGPF("Sent %" PRIu64 " frames in %" PRIu64 " transmit calls", packets, calls);
+	}
+
+	if(global_cfg.batch.calls){
+		LOGPF("Received %" PRIu64 " packets in %" PRIu64 " receive calls", global_cfg.batch.packets, global_cfg.batch.calls);
+	}
+	mmbackend_recv_free(&global_cfg.batch);
+	global_cfg.batch.calls = global_cfg.batch.packets = 0;
 	LOG("Backend shut down");
 	return 0;
 }
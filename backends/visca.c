@@ -34,7 +34,8 @@ MM_PLUGIN_API int init(){
 		.handle = ptz_set,
 		.process = ptz_handle,
 		.start = ptz_start,
-		.shutdown = ptz_shutdown
+		.shutdown = ptz_shutdown,
+		.flags = mmbackend_no_echo
 	};
 
 	//register backend
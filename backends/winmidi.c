@@ -33,7 +33,8 @@ MM_PLUGIN_API int init(){
 		.handle = winmidi_set,
 		.process = winmidi_handle,
 		.start = winmidi_start,
-		.shutdown = winmidi_shutdown
+		.shutdown = winmidi_shutdown,
+		.flags = mmbackend_no_echo
 	};
 
 	if(sizeof(winmidi_channel_ident) != sizeof(uint64_t)){
@@ -354,7 +355,7 @@ static void winmidi_handle_epn(instance* inst, uint8_t chan, uint16_t control, u
 	winmidi_channel_ident ident = {
 		.label = 0
 	};
-	channel_value val;
+	channel_value val = {0};
 
 	//switching between nrpn and rpn clears all valid bits
 	if(((data->epn_status[chan] & EPN_NRPN) && (control == 101 || control == 100))
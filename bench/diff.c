@@ -0,0 +1,189 @@
+/*
+ * Universe frame differencing benchmark
+ *
+ * Measures the per-frame cost of finding the changed slots of a merged universe,
+ * as done by the Art-Net and sACN backends for every received frame via
+ * mmbackend_diff(), against the slot-by-slot comparison used before. Frames are
+ * generated at several change densities, and every result is checked against
+ * the slot-by-slot comparison, which serves as the reference.
+ *
+ * Usage: ./diff [<iterations>]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "backends/libmmbackend.h"
+
+#define DEFAULT_ITERATIONS 2000000
+//distinct frames per density, cycled through while measuring
+#define FRAMES 64
+//randomized frames checked for every density, using partially active universes
+#define CHECKS 10000
+
+#if defined(MMBACKEND_NO_SIMD)
+	#define DIFF_VARIANT "portable"
+#elif defined(__AVX2__)
+	#define DIFF_VARIANT "AVX2"
+#elif defined(__SSE2__)
+	#define DIFF_VARIANT "SSE2"
+#else
+	#define DIFF_VARIANT "portable"
+#endif
+
+typedef struct {
+	char* name;
+	//fraction of changed slots, 0 for a single changed slot, negative for none
+	double density;
+} bench_density;
+
+static uint64_t clock_ns(){
+	struct timespec current;
+	clock_gettime(CLOCK_MONOTONIC, &current);
+	return ((uint64_t) current.tv_sec) * 1000000000 + current.tv_nsec;
+}
+
+//xorshift32, fixed seed so every run compares the same frames
+static uint32_t next_index(uint32_t* state, size_t n){
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state % n;
+}
+
+static size_t reference_diff(uint8_t* previous, uint8_t* current, uint8_t* active, uint64_t* changed){
+	size_t u, changes = 0;
+
+	memset(changed, 0, MMBACKEND_DIFF_WORDS * sizeof(uint64_t));
+	for(u = 0; u < MMBACKEND_DIFF_SLOTS; u++){
+		if(active[u] && previous[u] != current[u]){
+			changed[u / 64] |= ((uint64_t) 1) << (u % 64);
+			changes++;
+		}
+	}
+	return changes;
+}
+
+static void bench_frame(uint32_t* state, uint8_t* previous, uint8_t* current, double density){
+	size_t u;
+
+	for(u = 0; u < MMBACKEND_DIFF_SLOTS; u++){
+		previous[u] = current[u] = next_index(state, 256);
+	}
+
+	if(density < 0){
+		return;
+	}
+	else if(density == 0){
+		current[next_index(state, MMBACKEND_DIFF_SLOTS)]++;
+		return;
+	}
+
+	for(u = 0; u < MMBACKEND_DIFF_SLOTS; u++){
+		if(next_index(state, 10000) < density * 10000){
+			current[u]++;
+		}
+	}
+}
+
+static int bench_check(uint32_t* state, double density){
+	uint8_t previous[MMBACKEND_DIFF_SLOTS], current[MMBACKEND_DIFF_SLOTS], active[MMBACKEND_DIFF_SLOTS];
+	uint64_t changed[MMBACKEND_DIFF_WORDS], expected[MMBACKEND_DIFF_WORDS];
+	size_t u, p;
+
+	for(u = 0; u < CHECKS; u++){
+		bench_frame(state, previous, current, density);
+		//the first check runs on a fully active universe, all others on a random subset
+		for(p = 0; p < MMBACKEND_DIFF_SLOTS; p++){
+			active[p] = (!u || next_index(state, 4)) ? 0xFF : 0;
+		}
+
+		if(mmbackend_diff(previous, current, active, changed) != reference_diff(previous, current, active, expected)
+				|| memcmp(changed, expected, sizeof(changed))){
+			fprintf(stderr, "Result mismatch at density %.2f\n", density);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int bench_run(bench_density* density, size_t iterations){
+	uint8_t* previous = calloc(FRAMES, MMBACKEND_DIFF_SLOTS);
+	uint8_t* current = calloc(FRAMES, MMBACKEND_DIFF_SLOTS);
+	uint8_t active[MMBACKEND_DIFF_SLOTS];
+	uint64_t changed[MMBACKEND_DIFF_WORDS];
+	uint32_t state = 1;
+	size_t u, changes = 0, expected = 0;
+	uint64_t start;
+	double diff, reference;
+	int rv = 1;
+
+	if(!previous || !current){
+		fprintf(stderr, "Failed to allocate memory\n");
+		goto bail;
+	}
+
+	if(bench_check(&state, density->density)){
+		goto bail;
+	}
+
+	memset(active, 0xFF, sizeof(active));
+	for(u = 0; u < FRAMES; u++){
+		bench_frame(&state, previous + u * MMBACKEND_DIFF_SLOTS, current + u * MMBACKEND_DIFF_SLOTS, density->density);
+	}
+
+	start = clock_ns();
+	for(u = 0; u < iterations; u++){
+		changes += mmbackend_diff(previous + (u % FRAMES) * MMBACKEND_DIFF_SLOTS, current + (u % FRAMES) * MMBACKEND_DIFF_SLOTS, active, changed);
+	}
+	diff = (double) (clock_ns() - start) / iterations;
+
+	start = clock_ns();
+	for(u = 0; u < iterations; u++){
+		expected += reference_diff(previous + (u % FRAMES) * MMBACKEND_DIFF_SLOTS, current + (u % FRAMES) * MMBACKEND_DIFF_SLOTS, active, changed);
+	}
+	reference = (double) (clock_ns() - start) / iterations;
+
+	if(changes != expected){
+		fprintf(stderr, "Change count mismatch: %zu changes, %zu expected\n", changes, expected);
+		goto bail;
+	}
+
+	printf("%10s: %6.1f changed slots, per slot %.1f ns/frame, mmbackend_diff (%s) %.1f ns/frame\n",
+			density->name, (double) changes / iterations, reference, DIFF_VARIANT, diff);
+	rv = 0;
+
+bail:
+	free(previous);
+	free(current);
+	return rv;
+}
+
+int main(int argc, char** argv){
+	bench_density densities[] = {
+		{"unchanged", -1},
+		{"one slot", 0},
+		{"1%", 0.01},
+		{"10%", 0.1},
+		{"all slots", 1}
+	};
+	size_t iterations = DEFAULT_ITERATIONS, u;
+
+	if(argc > 1){
+		iterations = strtoul(argv[1], NULL, 10);
+	}
+
+	if(!iterations){
+		fprintf(stderr, "Usage: %s [<iterations>]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	for(u = 0; u < sizeof(densities) / sizeof(bench_density); u++){
+		if(bench_run(densities + u, iterations)){
+			return EXIT_FAILURE;
+		}
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,85 @@
+#!/bin/sh
+# Generates a configuration with <instances> Art-Net or sACN universes looped back over the local host.
+# A generator instance drives one channel per output universe (interface 1), which is received
+# by the matching input universe (interface 0) and routed into a generator sink, so every
+# received packet is resolved to its instance via mm_instance_lookup.
+#
+# Usage: ./instances.sh [<instances> [<rate> [artnet|sacn]]] > instances.cfg
+
+INSTANCES=${1:-1024}
+RATE=${2:-100000}
+BACKEND=${3:-artnet}
+
+if [ "$INSTANCES" -lt 1 ] || [ "$INSTANCES" -gt 32768 ]; then
+	printf "Instance count must be between 1 and 32768\n" >&2
+	exit 1
+fi
+
+if [ "$BACKEND" = "sacn" ]; then
+	if [ "$INSTANCES" -gt 63999 ]; then
+		printf "sACN supports at most 63999 universes\n" >&2
+		exit 1
+	fi
+	PORT=15568
+elif [ "$BACKEND" = "artnet" ]; then
+	PORT=16454
+else
+	printf "Unsupported backend %s, use artnet or sacn\n" "$BACKEND" >&2
+	exit 1
+fi
+
+cat <<EOF
+; generated by bench/instances.sh $INSTANCES $RATE $BACKEND
+[backend $BACKEND]
+bind = 127.0.0.1 $PORT
+bind = 127.0.0.1 $((PORT + 1))
+
+[generator gen]
+rate = $RATE
+pattern = ramp
+
+[generator sink]
+source = gen
+EOF
+
+n=0
+while [ $n -lt "$INSTANCES" ]; do
+	if [ "$BACKEND" = "sacn" ]; then
+		cat <<EOF
+
+[sacn out$n]
+universe = $((n + 1))
+interface = 1
+priority = 100
+realtime = 1
+unicast = 1
+destination = 127.0.0.1 $PORT
+
+[sacn in$n]
+universe = $((n + 1))
+unicast = 1
+EOF
+	else
+		cat <<EOF
+
+[artnet out$n]
+net = $((n / 256))
+universe = $((n % 256))
+interface = 1
+realtime = 1
+destination = 127.0.0.1 $PORT
+
+[artnet in$n]
+net = $((n / 256))
+universe = $((n % 256))
+EOF
+	fi
+	n=$((n + 1))
+done
+
+printf "\n[map]\n"
+n=0
+while [ $n -lt "$INSTANCES" ]; do
+	printf "gen.%d > out%d.1\nin%d.1 > sink.%d\n" $((n + 1)) $n $n $((n + 1))
+	n=$((n + 1))
+done
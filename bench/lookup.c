@@ -0,0 +1,168 @@
+/*
+ * Instance lookup benchmark
+ *
+ * Measures the per-packet cost of resolving an instance identifier, as done by
+ * the network backends for every received packet via mm_instance_lookup().
+ * The core registry is linked in directly and compared against the linear scan
+ * over all instances of a backend that was used before the identifier index.
+ *
+ * Usage: ./lookup [<iterations> [<instances> ...]]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "midimonster.h"
+#include "core/backend.h"
+
+#define DEFAULT_ITERATIONS 10000000
+
+//identifier layout as used by the Art-Net backend
+typedef union {
+	struct {
+		uint8_t fd_index;
+		uint8_t net;
+		uint8_t uni;
+	} fields;
+	uint64_t label;
+} bench_instance_id;
+
+//the frontend provides the log sink, only errors are of interest here
+MM_API int log_printf(int level, char* module, char* fmt, ...){
+	return 0;
+}
+
+static uint64_t clock_ns(){
+	struct timespec current;
+	clock_gettime(CLOCK_MONOTONIC, &current);
+	return ((uint64_t) current.tv_sec) * 1000000000 + current.tv_nsec;
+}
+
+//xorshift32, fixed seed so every run looks up the same identifier sequence
+static uint32_t next_index(uint32_t* state, size_t n){
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state % n;
+}
+
+static uint64_t bench_label(size_t u){
+	bench_instance_id id = {
+		.label = 0
+	};
+	id.fields.net = (u >> 8) & 0x7F;
+	id.fields.uni = u & 0xFF;
+	return id.label;
+}
+
+static int bench_start(size_t n, instance** inst){
+	size_t u;
+	for(u = 0; u < n; u++){
+		inst[u]->ident = bench_label(u);
+	}
+	return 0;
+}
+
+static int bench_shutdown(size_t n, instance** inst){
+	return 0;
+}
+
+static instance* linear_lookup(instance** inst, size_t n, uint64_t ident){
+	size_t u;
+	for(u = 0; u < n; u++){
+		if(inst[u]->ident == ident){
+			return inst[u];
+		}
+	}
+	return NULL;
+}
+
+static int bench_run(size_t instances, size_t iterations){
+	backend* b = NULL;
+	instance** inst = NULL;
+	backend template = {
+		.name = "bench",
+		.start = bench_start,
+		.shutdown = bench_shutdown
+	};
+	uint32_t state = 1;
+	uint64_t start;
+	size_t u, n = 0, hits = 0;
+	double linear, index;
+
+	if(mm_backend_register(template)){
+		fprintf(stderr, "Failed to register benchmark backend\n");
+		return 1;
+	}
+	b = backend_match("bench");
+
+	for(u = 0; u < instances; u++){
+		if(!mm_instance(b)){
+			fprintf(stderr, "Failed to create instance\n");
+			backends_stop();
+			return 1;
+		}
+	}
+
+	//assigns the identifiers and builds the lookup index
+	if(backends_start() || mm_backend_instances("bench", &n, &inst)){
+		fprintf(stderr, "Failed to start benchmark backend\n");
+		backends_stop();
+		return 1;
+	}
+
+	start = clock_ns();
+	for(u = 0; u < iterations; u++){
+		hits += (linear_lookup(inst, n, bench_label(next_index(&state, instances))) != NULL);
+	}
+	linear = (double) (clock_ns() - start) / iterations;
+
+	state = 1;
+	start = clock_ns();
+	for(u = 0; u < iterations; u++){
+		hits += (mm_instance_lookup(b, bench_label(next_index(&state, instances))) != NULL);
+	}
+	index = (double) (clock_ns() - start) / iterations;
+
+	if(hits != 2 * iterations){
+		fprintf(stderr, "Lookup mismatch: %zu of %zu lookups succeeded\n", hits, 2 * iterations);
+	}
+
+	printf("%6zu instances: linear scan %.1f ns/lookup, index %.1f ns/lookup\n", instances, linear, index);
+
+	free(inst);
+	backends_stop();
+	return 0;
+}
+
+int main(int argc, char** argv){
+	size_t defaults[] = {1, 64, 1024};
+	size_t iterations = DEFAULT_ITERATIONS, u;
+
+	if(argc > 1){
+		iterations = strtoul(argv[1], NULL, 10);
+	}
+
+	if(!iterations){
+		fprintf(stderr, "Usage: %s [<iterations> [<instances> ...]]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if(argc > 2){
+		for(u = 2; u < argc; u++){
+			if(bench_run(strtoul(argv[u], NULL, 10), iterations)){
+				return EXIT_FAILURE;
+			}
+		}
+		return EXIT_SUCCESS;
+	}
+
+	for(u = 0; u < sizeof(defaults) / sizeof(size_t); u++){
+		if(bench_run(defaults[u], iterations)){
+			return EXIT_FAILURE;
+		}
+	}
+	return EXIT_SUCCESS;
+}
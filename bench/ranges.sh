@@ -0,0 +1,41 @@
+#!/bin/sh
+# Generates a configuration mapping <universes> Art-Net input universes to as many output
+# universes, with one range glob of <channels> channels per universe and direction.
+# The load-only core option makes the MIDIMonster exit right after all mappings have been
+# resolved and compiled, without starting the backends.
+#
+# Usage: ./ranges.sh [<universes> [<channels>]] > ranges.cfg
+
+UNIVERSES=${1:-512}
+CHANNELS=${2:-512}
+
+if [ "$UNIVERSES" -lt 1 ] || [ "$UNIVERSES" -gt 16384 ] || [ "$CHANNELS" -lt 1 ] || [ "$CHANNELS" -gt 512 ]; then
+	printf "Universe count must be between 1 and 16384, channel count between 1 and 512\n" >&2
+	exit 1
+fi
+
+printf "; generated by bench/ranges.sh %d %d\n" "$UNIVERSES" "$CHANNELS"
+printf "[core]\nload-only = on\n"
+
+n=0
+while [ $n -lt "$UNIVERSES" ]; do
+	cat <<EOC
+
+[artnet in$n]
+net = $((n / 256))
+universe = $((n % 256))
+
+[artnet out$n]
+net = $(((n + UNIVERSES) / 256))
+universe = $(((n + UNIVERSES) % 256))
+destination = 127.0.0.1
+EOC
+	n=$((n + 1))
+done
+
+printf "\n[map]\n"
+n=0
+while [ $n -lt "$UNIVERSES" ]; do
+	printf "in%d.{1..%d} > out%d.{1..%d}\n" $n "$CHANNELS" $n "$CHANNELS"
+	n=$((n + 1))
+done
@@ -0,0 +1,159 @@
+/*
+ * Datagram transmission benchmark
+ *
+ * Measures the per-frame cost of sending batches of Art-Net sized datagrams,
+ * comparing one sendto() call per frame (as the Art-Net and sACN backends did
+ * before batching output) with the batched output of the backend library,
+ * which transmits each batch with sendmmsg(). Frames are sent over the local
+ * host to a socket that is never read, so the receiver just drops them.
+ *
+ * Usage: ./sendmmsg [<frames> [<batch size> ...]]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "backends/libmmbackend.h"
+
+#define DEFAULT_FRAMES 1000000
+//size of an Art-Net DMX frame with 512 channels
+#define FRAME_SIZE 530
+
+static uint64_t clock_ns(){
+	struct timespec current;
+	clock_gettime(CLOCK_MONOTONIC, &current);
+	return ((uint64_t) current.tv_sec) * 1000000000 + current.tv_nsec;
+}
+
+static double bench_sendto(int fd, uint8_t* frames, size_t batch, size_t rounds, struct sockaddr_in* dest){
+	size_t u, r;
+	uint64_t start = clock_ns();
+
+	for(r = 0; r < rounds; r++){
+		for(u = 0; u < batch; u++){
+			if(sendto(fd, frames + u * FRAME_SIZE, FRAME_SIZE, 0, (struct sockaddr*) dest, sizeof(struct sockaddr_in)) < 0){
+				fprintf(stderr, "sendto failed: %s\n", strerror(errno));
+				return -1;
+			}
+		}
+	}
+	return (double) (clock_ns() - start) / (rounds * batch);
+}
+
+static double bench_batch(int fd, uint8_t* frames, size_t batch, size_t rounds, struct sockaddr_in* dest, double* per_call){
+	mmbackend_send_batch output = {
+		0
+	};
+	size_t u, r;
+	uint64_t start;
+	double rv = -1;
+
+	if(mmbackend_send_init(&output, batch)){
+		return -1;
+	}
+
+	start = clock_ns();
+	for(r = 0; r < rounds; r++){
+		for(u = 0; u < batch; u++){
+			mmbackend_send_queue(&output, frames + u * FRAME_SIZE, FRAME_SIZE, (struct sockaddr*) dest, sizeof(struct sockaddr_in));
+		}
+
+		if(mmbackend_send_flush(&output, fd) != batch){
+			fprintf(stderr, "Batch transmission failed: %s\n", strerror(errno));
+			goto bail;
+		}
+	}
+	rv = (double) (clock_ns() - start) / (rounds * batch);
+	*per_call = (double) output.packets / output.calls;
+
+bail:
+	mmbackend_send_free(&output);
+	return rv;
+}
+
+static int bench_run(int fd, struct sockaddr_in* dest, size_t frames, size_t batch){
+	uint8_t* data = calloc(batch, FRAME_SIZE);
+	size_t rounds = frames / batch;
+	double single, batched, per_call = 0;
+
+	if(!data){
+		fprintf(stderr, "Failed to allocate memory\n");
+		return 1;
+	}
+
+	if(!rounds){
+		rounds = 1;
+	}
+
+	batched = bench_batch(fd, data, batch, rounds, dest, &per_call);
+	single = bench_sendto(fd, data, batch, rounds, dest);
+	free(data);
+	if(single < 0 || batched < 0){
+		return 1;
+	}
+
+	printf("%6zu frames per batch: sendto %.1f ns/frame, batched %.1f ns/frame (%.1f frames per call)\n", batch, single, batched, per_call);
+	return 0;
+}
+
+int main(int argc, char** argv){
+	size_t defaults[] = {1, 16, 256};
+	size_t frames = DEFAULT_FRAMES, u;
+	struct sockaddr_in dest = {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+	};
+	socklen_t dest_len = sizeof(dest);
+	int rv = EXIT_FAILURE, sink = -1, fd = -1;
+
+	if(argc > 1){
+		frames = strtoul(argv[1], NULL, 10);
+	}
+
+	if(!frames){
+		fprintf(stderr, "Usage: %s [<frames> [<batch size> ...]]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	//receiving socket on an ephemeral port, never read from
+	sink = socket(AF_INET, SOCK_DGRAM, 0);
+	fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if(sink < 0 || fd < 0
+			|| bind(sink, (struct sockaddr*) &dest, sizeof(dest))
+			|| getsockname(sink, (struct sockaddr*) &dest, &dest_len)){
+		fprintf(stderr, "Failed to set up sockets: %s\n", strerror(errno));
+		goto bail;
+	}
+
+	if(argc > 2){
+		for(u = 2; u < argc; u++){
+			if(!strtoul(argv[u], NULL, 10) || bench_run(fd, &dest, frames, strtoul(argv[u], NULL, 10))){
+				goto bail;
+			}
+		}
+	}
+	else{
+		for(u = 0; u < sizeof(defaults) / sizeof(size_t); u++){
+			if(bench_run(fd, &dest, frames, defaults[u])){
+				goto bail;
+			}
+		}
+	}
+
+	rv = EXIT_SUCCESS;
+bail:
+	if(sink >= 0){
+		close(sink);
+	}
+	if(fd >= 0){
+		close(fd);
+	}
+	return rv;
+}
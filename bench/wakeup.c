@@ -0,0 +1,216 @@
+/*
+ * Descriptor wakeup benchmark
+ *
+ * Measures the cost of one main loop wakeup for a single readable descriptor
+ * among n registered ones, comparing the select() loop the core used before
+ * (copy of a cached descriptor set, scan of all registered descriptors) with
+ * a persistent epoll set as used by the `epoll` and `epoll-edge` multiplexers.
+ *
+ * Usage: ./wakeup [<iterations> [<descriptors> ...]]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/select.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+#define DEFAULT_ITERATIONS 200000
+#define EVENT_BUFFER 64
+
+static uint64_t clock_ns(){
+	struct timespec current;
+	clock_gettime(CLOCK_MONOTONIC, &current);
+	return ((uint64_t) current.tv_sec) * 1000000000 + current.tv_nsec;
+}
+
+//xorshift32, fixed seed so every run signals the same descriptor sequence
+static uint32_t next_index(uint32_t* state, size_t n){
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state % n;
+}
+
+static int signal_fd(int fd){
+	uint8_t token = 1;
+	return write(fd, &token, 1) != 1;
+}
+
+static double bench_select(int* readers, int* writers, size_t n, size_t iterations){
+	fd_set cached, read_fds;
+	uint32_t state = 1;
+	size_t u, i;
+	int max_fd = -1;
+	uint8_t token;
+	uint64_t start;
+
+	FD_ZERO(&cached);
+	for(u = 0; u < n; u++){
+		FD_SET(readers[u], &cached);
+		max_fd = (readers[u] > max_fd) ? readers[u] : max_fd;
+	}
+
+	start = clock_ns();
+	for(i = 0; i < iterations; i++){
+		signal_fd(writers[next_index(&state, n)]);
+
+		read_fds = cached;
+		if(select(max_fd + 1, &read_fds, NULL, NULL, NULL) < 0){
+			fprintf(stderr, "select failed: %s\n", strerror(errno));
+			return -1;
+		}
+
+		//the core checks every registered descriptor after select returns
+		for(u = 0; u < n; u++){
+			if(FD_ISSET(readers[u], &read_fds)){
+				if(read(readers[u], &token, 1) != 1){
+					return -1;
+				}
+			}
+		}
+	}
+	return (double) (clock_ns() - start) / iterations;
+}
+
+#ifdef __linux__
+static double bench_epoll(int* readers, int* writers, size_t n, size_t iterations){
+	struct epoll_event ev = {
+		.events = EPOLLIN
+	}, events[EVENT_BUFFER];
+	uint32_t state = 1;
+	size_t u, i;
+	int epoll_fd = epoll_create1(0), ready, r;
+	uint8_t token;
+	uint64_t start;
+	double rv = -1;
+
+	if(epoll_fd < 0){
+		fprintf(stderr, "Failed to create epoll instance: %s\n", strerror(errno));
+		return -1;
+	}
+
+	for(u = 0; u < n; u++){
+		ev.data.u64 = u;
+		if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, readers[u], &ev)){
+			fprintf(stderr, "Failed to register descriptor: %s\n", strerror(errno));
+			goto bail;
+		}
+	}
+
+	start = clock_ns();
+	for(i = 0; i < iterations; i++){
+		signal_fd(writers[next_index(&state, n)]);
+
+		ready = epoll_wait(epoll_fd, events, EVENT_BUFFER, -1);
+		if(ready < 0){
+			fprintf(stderr, "epoll_wait failed: %s\n", strerror(errno));
+			goto bail;
+		}
+
+		//only signaled descriptors are visited
+		for(r = 0; r < ready; r++){
+			if(read(readers[events[r].data.u64], &token, 1) != 1){
+				goto bail;
+			}
+		}
+	}
+	rv = (double) (clock_ns() - start) / iterations;
+
+bail:
+	close(epoll_fd);
+	return rv;
+}
+#endif
+
+static int run(size_t n, size_t iterations){
+	int* readers = calloc(n, sizeof(int)), *writers = calloc(n, sizeof(int)), pipe_fds[2], max_fd = -1;
+	size_t u, opened = 0;
+	double select_ns = -1, epoll_ns = -1;
+	int rv = 1;
+
+	if(!readers || !writers){
+		fprintf(stderr, "Failed to allocate memory\n");
+		goto bail;
+	}
+
+	for(opened = 0; opened < n; opened++){
+		if(pipe(pipe_fds)){
+			fprintf(stderr, "Failed to create descriptor %zu of %zu: %s\n", opened + 1, n, strerror(errno));
+			goto bail;
+		}
+		fcntl(pipe_fds[0], F_SETFL, O_NONBLOCK);
+		readers[opened] = pipe_fds[0];
+		writers[opened] = pipe_fds[1];
+		max_fd = (pipe_fds[0] > max_fd) ? pipe_fds[0] : max_fd;
+	}
+
+	//select can not watch descriptor numbers beyond FD_SETSIZE
+	if(max_fd < FD_SETSIZE){
+		select_ns = bench_select(readers, writers, n, iterations);
+	}
+	#ifdef __linux__
+	epoll_ns = bench_epoll(readers, writers, n, iterations);
+	#endif
+
+	printf("%6zu descriptors: ", n);
+	if(select_ns >= 0){
+		printf("select %8.0f ns/wakeup", select_ns);
+	}
+	else{
+		printf("select %8s ns/wakeup", (max_fd < FD_SETSIZE) ? "failed" : "n/a");
+	}
+	if(epoll_ns >= 0){
+		printf(", epoll %8.0f ns/wakeup", epoll_ns);
+	}
+	printf("\n");
+	rv = 0;
+
+bail:
+	for(u = 0; u < opened; u++){
+		close(readers[u]);
+		close(writers[u]);
+	}
+	free(readers);
+	free(writers);
+	return rv;
+}
+
+int main(int argc, char** argv){
+	size_t default_sizes[] = {16, 256, 2048}, u, iterations = DEFAULT_ITERATIONS;
+	struct rlimit limit;
+
+	if(argc > 1){
+		iterations = strtoul(argv[1], NULL, 10);
+	}
+
+	//two descriptors per pipe
+	if(!getrlimit(RLIMIT_NOFILE, &limit) && limit.rlim_cur < limit.rlim_max){
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+
+	printf("%zu wakeups per measurement, FD_SETSIZE %d\n", iterations, FD_SETSIZE);
+	if(argc > 2){
+		for(u = 2; u < argc; u++){
+			if(run(strtoul(argv[u], NULL, 10), iterations)){
+				return 1;
+			}
+		}
+		return 0;
+	}
+
+	for(u = 0; u < sizeof(default_sizes) / sizeof(default_sizes[0]); u++){
+		if(run(default_sizes[u], iterations)){
+			return 1;
+		}
+	}
+	return 0;
+}
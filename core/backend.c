@@ -6,33 +6,314 @@
 #endif
 
 #define BACKEND_NAME "core/be"
+#define MM_CHANNEL_HASH_INITIAL 256
+#define MM_CHANNEL_SLAB 256
+#define MM_CHANNEL_DIRECT 4096
 #include "midimonster.h"
+#include "core.h"
 #include "backend.h"
+#include "thread.h"
+#include "stats.h"
 
 static uint32_t default_interval = 1000;
 
+//open-addressing index of a backend's instances by ident, power-of-two sized
+typedef struct /*_mm_instance_index*/ {
+	size_t alloc;
+	instance** slot;
+} instance_index;
+
 static struct {
 	size_t n;
-	backend* backends;
+	//backends are allocated individually so handles stay valid while plugins are attached
+	backend** backends;
 	instance*** instances;
+	instance_index* index;
 } registry = {
 	.n = 0
 };
 
-//the global channel store was converted from a naive list to a hashmap of lists for performance reasons
+/*
+ * The global channel store is an open-addressing hash with linear probing over inline
+ * (instance, ident, channel) slots. Small identifiers (as used by most backends with
+ * numbered channels) bypass the hash via a per-instance direct-indexed array.
+ * Channel structures are carved from fixed-size slabs to avoid one allocation per channel.
+ *
+ * Lookups do not lock, as backends on worker threads resolve channels concurrently with
+ * the main thread. Writers are serialized by the thread lock, publish channel pointers
+ * only after the channel is set up and replace grown tables instead of reallocating them.
+ * Replaced tables are retired and only freed on shutdown, since readers may still use them.
+ * A lookup may miss a channel that is being moved or inserted concurrently, which mm_channel
+ * resolves by repeating the lookup under the lock.
+ */
+typedef struct /*_mm_channel_slot*/ {
+	instance* instance;
+	uint64_t ident;
+	channel* channel;
+} channel_slot;
+
+typedef struct /*_mm_channel_table*/ {
+	//always a power of two
+	size_t alloc;
+	channel_slot slot[];
+} channel_table;
+
+typedef struct /*_mm_channel_direct*/ {
+	size_t alloc;
+	channel* slot[];
+} channel_direct;
+
+//core-private instance data, allocated by mm_instance in place of plain instance structures
+typedef struct /*_mm_instance_private*/ {
+	instance instance;
+	channel_direct* direct;
+	mm_stats stats;
+} instance_private;
+
+//core-private backend data, allocated by mm_backend_register in place of plain backend structures
+typedef struct /*_mm_backend_private*/ {
+	backend backend;
+	mm_stats stats;
+} backend_private;
+
 static struct {
-	//channelstore hash is set up for 256 buckets
-	size_t n[256];
-	channel** entry[256];
+	size_t n;
+	channel_table* table;
+
+	//tables replaced while readers may still access them
+	size_t retired;
+	void** retire;
+
+	size_t slabs;
+	size_t slab_used;
+	channel** slab;
 } channels = {
-	.n = {
-		0
-	}
+	0
 };
 
-static size_t channelstore_hash(instance* inst, uint64_t ident){
-	uint64_t repr = ((uint64_t) inst) ^ ident;
-	return (repr ^ (repr >> 8) ^ (repr >> 16) ^ (repr >> 24) ^ (repr >> 32)) & 0xFF;
+static uint64_t backend_hash(uint64_t repr){
+	//64bit finalizer, spreads the entropy to the low bits used for indexing
+	repr ^= repr >> 33;
+	repr *= 0xFF51AFD7ED558CCDULL;
+	repr ^= repr >> 33;
+	return repr;
+}
+
+static size_t channelstore_hash(channel_table* table, instance* inst, uint64_t ident){
+	return backend_hash(((uint64_t) inst) ^ (ident * 0x9E3779B97F4A7C15ULL)) & (table->alloc - 1);
+}
+
+//writer-side probe, only valid with the thread lock held
+static size_t channelstore_probe(channel_table* table, instance* inst, uint64_t ident){
+	size_t slot = channelstore_hash(table, inst, ident);
+
+	//the table is never full, so this always terminates at a match or an empty slot
+	for(; table->slot[slot].channel; slot = (slot + 1) & (table->alloc - 1)){
+		if(table->slot[slot].instance == inst && table->slot[slot].ident == ident){
+			break;
+		}
+	}
+	return slot;
+}
+
+static void channelstore_retire(void* table){
+	void** retire = realloc(channels.retire, (channels.retired + 1) * sizeof(void*));
+
+	if(!retire){
+		//leaking the table is the only safe option while readers may still be using it
+		LOG("Failed to allocate memory");
+		return;
+	}
+	channels.retire = retire;
+	channels.retire[channels.retired++] = table;
+}
+
+static int channelstore_grow(){
+	size_t u, slot, alloc = channels.table ? channels.table->alloc * 2 : MM_CHANNEL_HASH_INITIAL;
+	channel_table* table = calloc(1, sizeof(channel_table) + alloc * sizeof(channel_slot));
+
+	if(!table){
+		LOG("Failed to allocate memory");
+		return 1;
+	}
+
+	table->alloc = alloc;
+	for(u = 0; channels.table && u < channels.table->alloc; u++){
+		if(channels.table->slot[u].channel){
+			slot = channelstore_probe(table, channels.table->slot[u].instance, channels.table->slot[u].ident);
+			table->slot[slot] = channels.table->slot[u];
+		}
+	}
+
+	if(channels.table){
+		channelstore_retire(channels.table);
+	}
+	__atomic_store_n(&channels.table, table, __ATOMIC_RELEASE);
+	DBGPF("Resized channel store to %" PRIsize_t " slots", alloc);
+	return 0;
+}
+
+static int channelstore_insert(channel* chan){
+	instance_private* inst = (instance_private*) chan->instance;
+	size_t slot, alloc;
+	channel_direct* direct = NULL;
+
+	if(chan->ident < MM_CHANNEL_DIRECT){
+		if(!inst->direct || chan->ident >= inst->direct->alloc){
+			//extend to the next power of two covering the identifier
+			for(alloc = inst->direct ? inst->direct->alloc : 16; alloc <= chan->ident; alloc *= 2){
+			}
+
+			direct = calloc(1, sizeof(channel_direct) + alloc * sizeof(channel*));
+			if(!direct){
+				LOG("Failed to allocate memory");
+				return 1;
+			}
+			direct->alloc = alloc;
+			if(inst->direct){
+				memcpy(direct->slot, inst->direct->slot, inst->direct->alloc * sizeof(channel*));
+				channelstore_retire(inst->direct);
+			}
+			__atomic_store_n(&inst->direct, direct, __ATOMIC_RELEASE);
+		}
+
+		__atomic_store_n(inst->direct->slot + chan->ident, chan, __ATOMIC_RELEASE);
+		return 0;
+	}
+
+	//keep the load factor at or below 3/4
+	if((!channels.table || (channels.n + 1) * 4 > channels.table->alloc * 3) && channelstore_grow()){
+		return 1;
+	}
+
+	slot = channelstore_probe(channels.table, chan->instance, chan->ident);
+	channels.table->slot[slot].instance = chan->instance;
+	channels.table->slot[slot].ident = chan->ident;
+	__atomic_store_n(&channels.table->slot[slot].channel, chan, __ATOMIC_RELEASE);
+	channels.n++;
+	return 0;
+}
+
+static int channelstore_remove(channel* chan){
+	instance_private* inst = (instance_private*) chan->instance;
+	channel_table* table = channels.table;
+	size_t slot, next, home, mask;
+
+	if(chan->ident < MM_CHANNEL_DIRECT){
+		if(!inst->direct || chan->ident >= inst->direct->alloc || inst->direct->slot[chan->ident] != chan){
+			return 1;
+		}
+		__atomic_store_n(inst->direct->slot + chan->ident, NULL, __ATOMIC_RELEASE);
+		return 0;
+	}
+
+	if(!channels.n){
+		return 1;
+	}
+
+	mask = table->alloc - 1;
+	slot = channelstore_probe(table, chan->instance, chan->ident);
+	if(table->slot[slot].channel != chan){
+		return 1;
+	}
+
+	//backward-shift deletion keeps probe sequences intact without tombstones
+	for(next = (slot + 1) & mask; table->slot[next].channel; next = (next + 1) & mask){
+		home = channelstore_hash(table, table->slot[next].instance, table->slot[next].ident);
+		if(((next - home) & mask) >= ((next - slot) & mask)){
+			table->slot[slot].instance = table->slot[next].instance;
+			table->slot[slot].ident = table->slot[next].ident;
+			__atomic_store_n(&table->slot[slot].channel, table->slot[next].channel, __ATOMIC_RELEASE);
+			slot = next;
+		}
+	}
+
+	__atomic_store_n(&table->slot[slot].channel, NULL, __ATOMIC_RELEASE);
+	channels.n--;
+	return 0;
+}
+
+//lock-free lookup, matches are verified against the channel itself since slots may change concurrently
+static channel* channelstore_find(instance* inst, uint64_t ident){
+	channel_direct* direct = NULL;
+	channel_table* table = NULL;
+	channel* chan = NULL;
+	size_t slot;
+
+	if(ident < MM_CHANNEL_DIRECT){
+		direct = __atomic_load_n(&((instance_private*) inst)->direct, __ATOMIC_ACQUIRE);
+		if(direct && ident < direct->alloc){
+			chan = __atomic_load_n(direct->slot + ident, __ATOMIC_ACQUIRE);
+		}
+		return (chan && __atomic_load_n(&chan->ident, __ATOMIC_RELAXED) == ident) ? chan : NULL;
+	}
+
+	table = __atomic_load_n(&channels.table, __ATOMIC_ACQUIRE);
+	if(!table){
+		return NULL;
+	}
+
+	for(slot = channelstore_hash(table, inst, ident);
+			(chan = __atomic_load_n(&table->slot[slot].channel, __ATOMIC_ACQUIRE));
+			slot = (slot + 1) & (table->alloc - 1)){
+		if(chan->instance == inst && __atomic_load_n(&chan->ident, __ATOMIC_RELAXED) == ident){
+			return chan;
+		}
+	}
+	return NULL;
+}
+
+static channel* channelstore_alloc(){
+	channel** slab = NULL;
+
+	if(!channels.slabs || channels.slab_used == MM_CHANNEL_SLAB){
+		slab = realloc(channels.slab, (channels.slabs + 1) * sizeof(channel*));
+		if(!slab){
+			LOG("Failed to allocate memory");
+			return NULL;
+		}
+		channels.slab = slab;
+
+		channels.slab[channels.slabs] = calloc(MM_CHANNEL_SLAB, sizeof(channel));
+		if(!channels.slab[channels.slabs]){
+			LOG("Failed to allocate memory");
+			return NULL;
+		}
+		channels.slabs++;
+		channels.slab_used = 0;
+	}
+
+	return channels.slab[channels.slabs - 1] + (channels.slab_used++);
+}
+
+int backend_process(backend* b, size_t nfds, managed_fd* fds){
+	uint64_t start = core_clock();
+	int rv = b->process(nfds, fds);
+
+	stats_call(&(((backend_private*) b)->stats), start);
+	return rv;
+}
+
+int backend_handle(instance* inst, size_t nev, channel** c, channel_value* v){
+	instance_private* data = (instance_private*) inst;
+	uint64_t start = core_clock();
+	int rv = inst->backend->handle(inst, nev, c, v);
+
+	stats_call(&(data->stats), start);
+	STATS_ADD(data->stats.events_out, nev);
+	return rv;
+}
+
+mm_stats* instance_stats(instance* inst){
+	return &(((instance_private*) inst)->stats);
+}
+
+mm_stats* backend_stats(backend* b){
+	return &(((backend_private*) b)->stats);
+}
+
+backend* backend_get(size_t u){
+	return (u < registry.n) ? registry.backends[u] : NULL;
 }
 
 int backends_handle(size_t nfds, managed_fd* fds){
@@ -44,7 +325,7 @@ int backends_handle(size_t nfds, managed_fd* fds){
 		n = 0;
 
 		for(p = 0; p < nfds; p++){
-			if(fds[p].backend == registry.backends + u){
+			if(fds[p].backend == registry.backends[u]){
 				xchg = fds[n];
 				fds[n] = fds[p];
 				fds[p] = xchg;
@@ -53,135 +334,164 @@ int backends_handle(size_t nfds, managed_fd* fds){
 		}
 
 		//handle if there is data ready or the backend has active instances for polling
-		if(n || registry.instances[u]){
-			DBGPF("Notifying backend %s of %" PRIsize_t " waiting FDs", registry.backends[u].name, n);
-			rv |= registry.backends[u].process(n, fds);
+		if((n || registry.instances[u]) && !thread_managed(registry.backends[u])){
+			DBGPF("Notifying backend %s of %" PRIsize_t " waiting FDs", registry.backends[u]->name, n);
+			rv |= backend_process(registry.backends[u], n, fds);
 			if(rv){
-				LOGPF("Backend %s failed to handle input", registry.backends[u].name);
+				LOGPF("Backend %s failed to handle input", registry.backends[u]->name);
 			}
 		}
 	}
 	return rv;
 }
 
-int backends_notify(size_t nev, channel** c, channel_value* v){
-	size_t u, p, n;
-	int rv = 0;
-	channel_value xval;
-	channel* xchnl = NULL;
-
-	for(u = 0; u < nev && !rv; u = n){
-		//sort for this instance
-		n = u + 1;
-		for(p = u + 1; p < nev; p++){
-			if(c[p]->instance == c[u]->instance){
-				xval = v[p];
-				xchnl = c[p];
-
-				v[p] = v[n];
-				c[p] = c[n];
-
-				v[n] = xval;
-				c[n] = xchnl;
-				n++;
-			}
-		}
-
-		/*
-		 * Do not eliminate duplicates here. There are legitimate uses for a channel occuring multiple times
-		 * in one loop iteration, e.g. stateful OSC layer selectors.
-		 */
-		DBGPF("Calling handler for instance %s with %" PRIsize_t " events", c[u]->instance->name, n - u);
-		rv |= c[u]->instance->backend->handle(c[u]->instance, n - u, c + u, v + u);
+int backends_notify(instance* inst, size_t nev, channel** c, channel_value* v){
+	//instances of backends running on a worker thread are handled there
+	if(thread_managed(inst->backend)){
+		return thread_notify(inst, nev, c, v);
 	}
 
-	return 0;
+	/*
+	 * Do not eliminate duplicates here. There are legitimate uses for a channel occuring multiple times
+	 * in one loop iteration, e.g. stateful OSC layer selectors.
+	 */
+	DBGPF("Calling handler for instance %s with %" PRIsize_t " events", inst->name, nev);
+	return backend_handle(inst, nev, c, v);
 }
 
-MM_API channel* mm_channel(instance* inst, uint64_t ident, uint8_t create){
-	size_t u, bucket = channelstore_hash(inst, ident);
-	DBGPF("\tSearching for inst %" PRIu64 " ident %" PRIu64, (uint64_t) inst, ident);
-	for(u = 0; u < channels.n[bucket]; u++){
-		DBGPF("\tBucket %" PRIsize_t " entry %" PRIsize_t " inst %" PRIu64 " ident %" PRIu64, bucket, u, (uint64_t) channels.entry[bucket][u]->instance, channels.entry[bucket][u]->ident);
-		if(channels.entry[bucket][u]->instance == inst
-				&& channels.entry[bucket][u]->ident == ident){
-			DBGPF("Requested channel %" PRIu64 " on instance %s already exists, reusing (bucket %" PRIsize_t ", %" PRIsize_t " search steps)", ident, inst->name, bucket, u);
-			return channels.entry[bucket][u];
-		}
+//create a channel if it does not exist yet, only called with the thread lock held
+static channel* channelstore_get(instance* inst, uint64_t ident, uint8_t create){
+	channel* chan = channelstore_find(inst, ident);
+
+	if(chan){
+		return chan;
 	}
 
 	if(!create){
-		DBGPF("Requested unknown channel %" PRIu64 " (bucket %" PRIsize_t ") on instance %s", ident, bucket, inst->name);
+		DBGPF("Requested unknown channel %" PRIu64 " on instance %s", ident, inst->name);
 		return NULL;
 	}
 
-	DBGPF("Creating previously unknown channel %" PRIu64 " on instance %s, bucket %" PRIsize_t, ident, inst->name, bucket);
-	channels.entry[bucket] = realloc(channels.entry[bucket], (channels.n[bucket] + 1) * sizeof(channel*));
-	if(!channels.entry[bucket]){
-		LOG("Failed to allocate memory");
-		channels.n[bucket] = 0;
+	DBGPF("Creating previously unknown channel %" PRIu64 " on instance %s", ident, inst->name);
+	chan = channelstore_alloc();
+	if(!chan){
 		return NULL;
 	}
 
-	channels.entry[bucket][channels.n[bucket]] = calloc(1, sizeof(channel));
-	if(!channels.entry[bucket][channels.n[bucket]]){
-		LOG("Failed to allocate memory");
+	chan->instance = inst;
+	chan->ident = ident;
+	if(channelstore_insert(chan)){
 		return NULL;
 	}
+	return chan;
+}
+
+MM_API channel* mm_channel(instance* inst, uint64_t ident, uint8_t create){
+	channel* chan = channelstore_find(inst, ident);
 
-	channels.entry[bucket][channels.n[bucket]]->instance = inst;
-	channels.entry[bucket][channels.n[bucket]]->ident = ident;
-	return channels.entry[bucket][(channels.n[bucket]++)];
+	if(chan){
+		return chan;
+	}
+
+	//the lookup may have raced with a writer on a worker thread, repeat it with the writers excluded
+	thread_lock();
+	chan = channelstore_get(inst, ident, create);
+	thread_unlock();
+	return chan;
 }
 
 MM_API void mm_channel_update(channel* chan, uint64_t ident){
-	size_t bucket = channelstore_hash(chan->instance, chan->ident), new_bucket = channelstore_hash(chan->instance, ident);
-	size_t u;
+	DBGPF("Updating identifier for inst %" PRIu64 " ident %" PRIu64 " to %" PRIu64, (uint64_t) chan->instance, chan->ident, ident);
 
-	DBGPF("Updating identifier for inst %" PRIu64 " ident %" PRIu64 " (bucket %" PRIsize_t " to %" PRIsize_t ") to %" PRIu64, (uint64_t) chan->instance, chan->ident, bucket, new_bucket, ident);
-
-	if(bucket == new_bucket){
-		chan->ident = ident;
+	thread_lock();
+	if(channelstore_remove(chan)){
+		DBGPF("Channel %" PRIu64 " on instance %s is not managed by the channel store", chan->ident, chan->instance->name);
+		__atomic_store_n(&chan->ident, ident, __ATOMIC_RELAXED);
+		thread_unlock();
 		return;
 	}
 
-	for(u = 0; u < channels.n[bucket]; u++){
-		if(channels.entry[bucket][u]->instance == chan->instance
-				&& channels.entry[bucket][u]->ident == chan->ident){
-			break;
-		}
+	__atomic_store_n(&chan->ident, ident, __ATOMIC_RELAXED);
+	channelstore_insert(chan);
+	thread_unlock();
+}
+
+static void instance_index_free(size_t u){
+	free(registry.index[u].slot);
+	registry.index[u].slot = NULL;
+	registry.index[u].alloc = 0;
+}
+
+static int instance_index_build(size_t u){
+	size_t n, slot;
+	instance** iter = NULL;
+
+	instance_index_free(u);
+	for(n = 0; registry.instances[u] && registry.instances[u][n]; n++){
 	}
 
-	if(u == channels.n[bucket]){
-		DBGPF("Failed to find channel to update in bucket %" PRIsize_t, bucket);
-		return;
+	if(!n){
+		return 0;
 	}
 
-	DBGPF("Removing channel from slot %" PRIsize_t " of %" PRIsize_t " of bucket %" PRIsize_t, u, channels.n[bucket], bucket);
-	//remove channel from old bucket
-	for(; u < channels.n[bucket] - 1; u++){
-		channels.entry[bucket][u] = channels.entry[bucket][u + 1];
+	//keep the load factor at or below 1/2
+	for(registry.index[u].alloc = 4; registry.index[u].alloc < 2 * n; registry.index[u].alloc *= 2){
 	}
 
-	//add to new bucket
-	channels.entry[new_bucket] = realloc(channels.entry[new_bucket], (channels.n[new_bucket] + 1) * sizeof(channel*));
-	if(!channels.entry[new_bucket]){
+	registry.index[u].slot = calloc(registry.index[u].alloc, sizeof(instance*));
+	if(!registry.index[u].slot){
 		LOG("Failed to allocate memory");
-		channels.n[new_bucket] = 0;
-		return;
+		registry.index[u].alloc = 0;
+		return 1;
 	}
 
-	channels.entry[new_bucket][channels.n[new_bucket]] = chan;
-	chan->ident = ident;
-	channels.n[bucket]--;
-	channels.n[new_bucket]++;
+	for(iter = registry.instances[u]; *iter; iter++){
+		for(slot = backend_hash((*iter)->ident) & (registry.index[u].alloc - 1);
+				registry.index[u].slot[slot];
+				slot = (slot + 1) & (registry.index[u].alloc - 1)){
+			//the first registered instance wins for duplicate identifiers, as with a linear search
+			if(registry.index[u].slot[slot]->ident == (*iter)->ident){
+				break;
+			}
+		}
+
+		if(!registry.index[u].slot[slot]){
+			registry.index[u].slot[slot] = *iter;
+		}
+	}
+
+	return 0;
+}
+
+static instance* instance_lookup(size_t u, uint64_t ident){
+	size_t slot;
+	instance** iter = NULL;
+
+	//the index is built once all instances have been started and set their identifiers
+	if(registry.index[u].alloc){
+		for(slot = backend_hash(ident) & (registry.index[u].alloc - 1);
+				registry.index[u].slot[slot];
+				slot = (slot + 1) & (registry.index[u].alloc - 1)){
+			if(registry.index[u].slot[slot]->ident == ident){
+				return registry.index[u].slot[slot];
+			}
+		}
+		return NULL;
+	}
+
+	for(iter = registry.instances[u]; iter && *iter; iter++){
+		if((*iter)->ident == ident){
+			return *iter;
+		}
+	}
+	return NULL;
 }
 
 instance* mm_instance(backend* b){
 	size_t u = 0, n = 0;
 
 	for(u = 0; u < registry.n; u++){
-		if(registry.backends + u == b){
+		if(registry.backends[u] == b){
 			//count existing instances
 			for(n = 0; registry.instances[u] && registry.instances[u][n]; n++){
 			}
@@ -194,7 +504,9 @@ instance* mm_instance(backend* b){
 			}
 			//sentinel
 			registry.instances[u][n + 1] = NULL;
-			registry.instances[u][n] = calloc(1, sizeof(instance));
+			//the identifier index is rebuilt on start
+			instance_index_free(u);
+			registry.instances[u][n] = calloc(1, sizeof(instance_private));
 			if(!registry.instances[u][n]){
 				LOG("Failed to allocate memory");
 			}
@@ -209,20 +521,25 @@ instance* mm_instance(backend* b){
 
 MM_API instance* mm_instance_find(char* name, uint64_t ident){
 	size_t b = 0;
-	instance** iter = NULL;
 	for(b = 0; b < registry.n; b++){
-		if(!strcmp(registry.backends[b].name, name)){
-			for(iter = registry.instances[b]; iter && *iter; iter++){
-				if((*iter)->ident == ident){
-					return *iter;
-				}
-			}
+		if(!strcmp(registry.backends[b]->name, name)){
+			return instance_lookup(b, ident);
 		}
 	}
 
 	return NULL;
 }
 
+MM_API instance* mm_instance_lookup(backend* b, uint64_t ident){
+	size_t u;
+	for(u = 0; u < registry.n; u++){
+		if(registry.backends[u] == b){
+			return instance_lookup(u, ident);
+		}
+	}
+	return NULL;
+}
+
 MM_API int mm_backend_instances(char* name, size_t* ninst, instance*** inst){
 	size_t b = 0, i = 0;
 	if(!ninst || !inst){
@@ -230,7 +547,7 @@ MM_API int mm_backend_instances(char* name, size_t* ninst, instance*** inst){
 	}
 
 	for(b = 0; b < registry.n; b++){
-		if(!strcmp(registry.backends[b].name, name)){
+		if(!strcmp(registry.backends[b]->name, name)){
 			//count instances
 			for(i = 0; registry.instances[b] && registry.instances[b][i]; i++){
 			}
@@ -257,8 +574,8 @@ MM_API int mm_backend_instances(char* name, size_t* ninst, instance*** inst){
 backend* backend_match(char* name){
 	size_t u;
 	for(u = 0; u < registry.n; u++){
-		if(!strcmp(registry.backends[u].name, name)){
-			return registry.backends + u;
+		if(!strcmp(registry.backends[u]->name, name)){
+			return registry.backends[u];
 		}
 	}
 	return NULL;
@@ -288,16 +605,16 @@ struct timeval backend_timeout(){
 	uint32_t res, secs = default_interval / 1000, msecs = default_interval % 1000;
 
 	for(u = 0; u < registry.n; u++){
-		//only call interval if backend has instances
-		if(registry.instances[u] && registry.backends[u].interval){
-			res = registry.backends[u].interval();
+		//only call interval if backend has instances, worker threads wait on their own
+		if(registry.instances[u] && registry.backends[u]->interval && !thread_managed(registry.backends[u])){
+			res = registry.backends[u]->interval();
 			if(res && (res / 1000) < secs){
-				DBGPF("Updating interval to %" PRIu32 " msecs by request from %s", res, registry.backends[u].name);
+				DBGPF("Updating interval to %" PRIu32 " msecs by request from %s", res, registry.backends[u]->name);
 				secs = res / 1000;
 				msecs = res % 1000;
 			}
 			else if(res && res / 1000 == secs && (res % 1000) < msecs){
-				DBGPF("Updating interval to %" PRIu32 " msecs by request from %s", res, registry.backends[u].name);
+				DBGPF("Updating interval to %" PRIu32 " msecs by request from %s", res, registry.backends[u]->name);
 				msecs = res % 1000;
 			}
 		}
@@ -312,15 +629,23 @@ struct timeval backend_timeout(){
 
 MM_API int mm_backend_register(backend b){
 	if(!backend_match(b.name)){
-		registry.backends = realloc(registry.backends, (registry.n + 1) * sizeof(backend));
+		registry.backends = realloc(registry.backends, (registry.n + 1) * sizeof(backend*));
 		registry.instances = realloc(registry.instances, (registry.n + 1) * sizeof(instance**));
-		if(!registry.backends || !registry.instances){
+		registry.index = realloc(registry.index, (registry.n + 1) * sizeof(instance_index));
+		if(!registry.backends || !registry.instances || !registry.index){
 			LOG("Failed to allocate memory");
 			registry.n = 0;
 			return 1;
 		}
-		registry.backends[registry.n] = b;
+		registry.backends[registry.n] = calloc(1, sizeof(backend_private));
+		if(!registry.backends[registry.n]){
+			LOG("Failed to allocate memory");
+			return 1;
+		}
+		*(registry.backends[registry.n]) = b;
 		registry.instances[registry.n] = NULL;
+		registry.index[registry.n].alloc = 0;
+		registry.index[registry.n].slot = NULL;
 		registry.n++;
 
 		LOGPF("Registered backend %s", b.name);
@@ -341,40 +666,66 @@ int backends_start(){
 		}
 
 		//fetch list of instances
-		if(mm_backend_instances(registry.backends[u].name, &n, &inst)){
-			LOGPF("Failed to fetch instance list for initialization of backend %s", registry.backends[u].name);
+		if(mm_backend_instances(registry.backends[u]->name, &n, &inst)){
+			LOGPF("Failed to fetch instance list for initialization of backend %s", registry.backends[u]->name);
 			return 1;
 		}
 
 		//start the backend
-		current = registry.backends[u].start(n, inst);
+		current = registry.backends[u]->start(n, inst);
 		if(current){
-			LOGPF("Failed to start backend %s", registry.backends[u].name);
+			LOGPF("Failed to start backend %s", registry.backends[u]->name);
 		}
 
 		//clean up
 		free(inst);
 		inst = NULL;
 		rv |= current;
+
+		//instance identifiers are final once the backend has started
+		rv |= instance_index_build(u);
 	}
 	return rv;
 }
 
 static void channels_free(){
 	size_t u, p;
-	for(u = 0; u < sizeof(channels.n) / sizeof(channels.n[0]); u++){
-		DBGPF("Cleaning up channel registry bucket %" PRIsize_t " with %" PRIsize_t " channels", u, channels.n[u]);
-		for(p = 0; p < channels.n[u]; p++){
-			DBGPF("Destroying channel %" PRIu64 " on instance %s", channels.entry[u][p]->ident, channels.entry[u][p]->instance->name);
+	channel* chan = NULL;
+	instance** iter = NULL;
+
+	for(u = 0; u < channels.slabs; u++){
+		DBGPF("Cleaning up channel slab %" PRIsize_t, u);
+		for(p = 0; p < ((u == channels.slabs - 1) ? channels.slab_used : MM_CHANNEL_SLAB); p++){
+			chan = channels.slab[u] + p;
+			DBGPF("Destroying channel %" PRIu64 " on instance %s", chan->ident, chan->instance->name);
 			//call the channel_free function if the backend supports it
-			if(channels.entry[u][p]->impl && channels.entry[u][p]->instance->backend->channel_free){
-				channels.entry[u][p]->instance->backend->channel_free(channels.entry[u][p]);
+			if(chan->impl && chan->instance->backend->channel_free){
+				chan->instance->backend->channel_free(chan);
 			}
-			free(channels.entry[u][p]);
 		}
-		free(channels.entry[u]);
-		channels.entry[u] = NULL;
-		channels.n[u] = 0;
+		free(channels.slab[u]);
+	}
+	free(channels.slab);
+	channels.slab = NULL;
+	channels.slabs = channels.slab_used = 0;
+
+	free(channels.table);
+	channels.table = NULL;
+	channels.n = 0;
+
+	for(u = 0; u < channels.retired; u++){
+		free(channels.retire[u]);
+	}
+	free(channels.retire);
+	channels.retire = NULL;
+	channels.retired = 0;
+
+	//release the direct-indexed channel arrays
+	for(u = 0; u < registry.n; u++){
+		for(iter = registry.instances[u]; iter && *iter; iter++){
+			free(((instance_private*) *iter)->direct);
+			((instance_private*) *iter)->direct = NULL;
+		}
 	}
 }
 
@@ -388,13 +739,13 @@ int backends_stop(){
 	//shut down the registry
 	for(u = 0; u < registry.n; u++){
 		//fetch list of instances
-		if(mm_backend_instances(registry.backends[u].name, &n, &inst)){
-			LOGPF("Failed to fetch instance list for shutdown of backend %s", registry.backends[u].name);
+		if(mm_backend_instances(registry.backends[u]->name, &n, &inst)){
+			LOGPF("Failed to fetch instance list for shutdown of backend %s", registry.backends[u]->name);
 			inst = NULL;
 			n = 0;
 		}
 
-		registry.backends[u].shutdown(n, inst);
+		registry.backends[u]->shutdown(n, inst);
 		free(inst);
 		inst = NULL;
 
@@ -407,10 +758,18 @@ int backends_stop(){
 		}
 		free(registry.instances[u]);
 		registry.instances[u] = NULL;
+		instance_index_free(u);
 	}
 
+	for(u = 0; u < registry.n; u++){
+		free(registry.backends[u]);
+	}
 	free(registry.backends);
 	free(registry.instances);
+	free(registry.index);
+	registry.backends = NULL;
+	registry.instances = NULL;
+	registry.index = NULL;
 	registry.n = 0;
 	return 0;
 }
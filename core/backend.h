@@ -2,7 +2,12 @@
 
 /* Internal API */
 int backends_handle(size_t nfds, managed_fd* fds);
-int backends_notify(size_t nev, channel** c, channel_value* v);
+int backend_process(backend* b, size_t nfds, managed_fd* fds);
+int backend_handle(instance* inst, size_t nev, channel** c, channel_value* v);
+mm_stats* instance_stats(instance* inst);
+mm_stats* backend_stats(backend* b);
+backend* backend_get(size_t u);
+int backends_notify(instance* inst, size_t nev, channel** c, channel_value* v);
 backend* backend_match(char* name);
 instance* instance_match(char* name);
 struct timeval backend_timeout();
@@ -17,5 +22,6 @@ void mm_default_interval(uint32_t interval, uint8_t force);
 MM_API channel* mm_channel(instance* inst, uint64_t ident, uint8_t create);
 MM_API void mm_channel_update(channel* chan, uint64_t ident);
 MM_API instance* mm_instance_find(char* name, uint64_t ident);
+MM_API instance* mm_instance_lookup(backend* b, uint64_t ident);
 MM_API int mm_backend_instances(char* name, size_t* ninst, instance*** inst);
 MM_API int mm_backend_register(backend b);
@@ -13,9 +13,11 @@
 #include "midimonster.h"
 #include "config.h"
 #include "backend.h"
+#include "core.h"
 
 static enum {
 	none,
+	core_cfg,
 	backend_cfg,
 	instance_cfg,
 	map
@@ -31,6 +33,10 @@ static backend* current_backend = NULL;
 static instance* current_instance = NULL;
 static size_t noverrides = 0;
 static config_override* overrides = NULL;
+//nesting level of included configuration files
+static size_t config_depth = 0;
+//resolve simple range globs through the backend channel_range callback
+static uint8_t bulk_ranges = 1;
 
 #ifdef _WIN32
 #define GETLINE_BUFFER 4096
@@ -309,6 +315,50 @@ bail:
 	return result;
 }
 
+static int config_glob_resolve_bulk(instance* inst, channel_spec* spec, uint8_t map_direction){
+	channel_glob* glob = spec->glob;
+	char* prefix = spec->spec, *suffix = NULL;
+	int rv = 1;
+
+	//only specs consisting of a single range glob can be passed to the backend directly
+	if(!bulk_ranges
+			|| !inst->backend->channel_range
+			|| spec->globs != 1
+			|| glob->type != glob_range){
+		return 1;
+	}
+
+	spec->resolved = calloc(spec->channels, sizeof(channel*));
+	if(!spec->resolved){
+		LOG("Failed to allocate memory");
+		return 1;
+	}
+
+	//split the spec around the glob
+	prefix[glob->offset[0]] = 0;
+	suffix = spec->spec + glob->offset[1] + 1;
+
+	rv = inst->backend->channel_range(inst, prefix, glob->limits.u64[0], glob->limits.u64[1], suffix, map_direction, spec->resolved);
+	prefix[glob->offset[0]] = '{';
+
+	if(rv){
+		DBGPF("Backend %s declined bulk resolution of %s, falling back", inst->backend->name, spec->spec);
+		free(spec->resolved);
+		spec->resolved = NULL;
+	}
+	return rv;
+}
+
+int config_configure(char* option, char* value){
+	if(!strcmp(option, "bulk-ranges")){
+		bulk_ranges = strcmp(value, "off") ? 1 : 0;
+		return 0;
+	}
+
+	LOGPF("Unknown configuration option %s", option);
+	return 1;
+}
+
 static int config_map(char* to_raw, char* from_raw){
 	//create a copy because the original pointer may be used multiple times
 	char* to = strdup(to_raw), *from = strdup(from_raw);
@@ -374,11 +424,17 @@ static int config_map(char* to_raw, char* from_raw){
 		goto done;
 	}
 
+	//try to have the backends resolve simple ranges in one call
+	config_glob_resolve_bulk(instance_from, &spec_from, mmchannel_input);
+	config_glob_resolve_bulk(instance_to, &spec_to, mmchannel_output);
+
 	//iterate, resolve globs and map
 	rv = 0;
 	for(n = 0; !rv && n < max(spec_from.channels, spec_to.channels); n++){
-		channel_from = config_glob_resolve(instance_from, &spec_from, min(n, spec_from.channels), mmchannel_input);
-		channel_to = config_glob_resolve(instance_to, &spec_to, min(n, spec_to.channels), mmchannel_output);
+		channel_from = spec_from.resolved ? spec_from.resolved[n % spec_from.channels]
+			: config_glob_resolve(instance_from, &spec_from, min(n, spec_from.channels), mmchannel_input);
+		channel_to = spec_to.resolved ? spec_to.resolved[n % spec_to.channels]
+			: config_glob_resolve(instance_to, &spec_to, min(n, spec_to.channels), mmchannel_output);
 
 		if(!channel_from || !channel_to){
 			rv = 1;
@@ -388,6 +444,8 @@ static int config_map(char* to_raw, char* from_raw){
 	}
 
 done:
+	free(spec_from.resolved);
+	free(spec_to.resolved);
 	free(spec_from.glob);
 	free(spec_to.glob);
 	free(from);
@@ -410,7 +468,7 @@ static int config_line(char* line){
 			//backend configuration
 			parser_state = backend_cfg;
 			line[strlen(line) - 1] = 0;
-			current_backend = backend_match(line + 9);
+			current_backend = core_backend(line + 9);
 
 			if(!current_backend){
 				LOGPF("Cannot configure unknown backend %s", line + 9);
@@ -430,6 +488,10 @@ static int config_line(char* line){
 				}
 			}
 		}
+		else if(!strcmp(line, "[core]")){
+			//core configuration
+			parser_state = core_cfg;
+		}
 		else if(!strncmp(line, "[include ", 9)){
 			line[strlen(line) - 1] = 0;
 			return config_read(line + 9);
@@ -456,7 +518,7 @@ static int config_line(char* line){
 			*separator = 0;
 			separator++;
 
-			current_backend = backend_match(line);
+			current_backend = core_backend(line);
 			if(!current_backend){
 				LOGPF("No such backend %s", line);
 				return 1;
@@ -548,7 +610,8 @@ static int config_line(char* line){
 		//find separator
 		separator = strchr(line, '=');
 		if(!separator){
-			LOGPF("Not an assignment (currently expecting %s configuration): %s", line, (parser_state == backend_cfg) ? "backend" : "instance");
+			LOGPF("Not an assignment (currently expecting %s configuration): %s",
+					(parser_state == core_cfg) ? "core" : ((parser_state == backend_cfg) ? "backend" : "instance"), line);
 			return 1;
 		}
 
@@ -557,7 +620,11 @@ static int config_line(char* line){
 		line = config_trim_line(line);
 		separator = config_trim_line(separator);
 
-		if(parser_state == backend_cfg && current_backend->conf(line, separator)){
+		if(parser_state == core_cfg && core_configure(line, separator)){
+			LOG("Failed to configure core");
+			return 1;
+		}
+		else if(parser_state == backend_cfg && current_backend->conf(line, separator)){
 			LOGPF("Failed to configure backend %s", current_backend->name);
 			return 1;
 		}
@@ -570,6 +637,21 @@ static int config_line(char* line){
 	return 0;
 }
 
+static int config_apply_core(){
+	size_t u;
+
+	for(u = 0; u < noverrides; u++){
+		if(!overrides[u].handled && overrides[u].type == override_core){
+			if(core_configure(overrides[u].option, overrides[u].value)){
+				LOGPF("Configuration override for %s failed for core", overrides[u].option);
+				return 1;
+			}
+			overrides[u].handled = 1;
+		}
+	}
+	return 0;
+}
+
 int config_read(char* cfg_filepath){
 	int rv = 1;
 	size_t line_alloc = 0;
@@ -618,11 +700,19 @@ int config_read(char* cfg_filepath){
 		goto bail;
 	}
 
+	config_depth++;
 	for(status = getline(&line_raw, &line_alloc, source); status >= 0; status = getline(&line_raw, &line_alloc, source)){
 		if(config_line(line_raw)){
+			config_depth--;
 			goto bail;
 		}
 	}
+	config_depth--;
+
+	//core overrides are applied once the top-level configuration is complete so they take precedence
+	if(!config_depth && config_apply_core()){
+		goto bail;
+	}
 
 	//TODO check whether all overrides have been applied
 
@@ -654,14 +744,21 @@ int config_add_override(override_type type, char* data_raw){
 	char* option = strchr(data, '.');
 	char* value = strchr(data, '=');
 
-	if(!option || !value){
+	//core overrides do not name a target
+	if(type == override_core){
+		option = data;
+	}
+
+	if(!option || !value || option > value){
 		LOGPF("Override %s is not a valid assignment", data_raw);
 		goto bail;
 	}
 
 	//terminate strings
-	*option = 0;
-	option++;
+	if(type != override_core){
+		*option = 0;
+		option++;
+	}
 
 	*value = 0;
 	value++;
@@ -669,7 +766,7 @@ int config_add_override(override_type type, char* data_raw){
 	config_override new = {
 		.type = type,
 		.handled = 0,
-		.target = strdup(config_trim_line(data)),
+		.target = strdup((type == override_core) ? "core" : config_trim_line(data)),
 		.option = strdup(config_trim_line(option)),
 		.value = strdup(config_trim_line(value))
 	};
@@ -28,6 +28,7 @@ typedef struct /*_mm_channel_spec*/ {
 	size_t channels;
 	size_t globs;
 	channel_glob* glob;
+	channel** resolved;
 } channel_spec;
 
 /*
@@ -35,7 +36,8 @@ typedef struct /*_mm_channel_spec*/ {
  */
 typedef enum {
 	override_backend,
-	override_instance
+	override_instance,
+	override_core
 } override_type;
 
 /*
@@ -51,6 +53,7 @@ typedef struct /*_mm_config_override*/ {
 
 /* Internal API */
 void config_free();
+int config_configure(char* option, char* value);
 
 /* Frontend API */
 int config_read(char* file);
@@ -6,6 +6,13 @@
 #ifndef _WIN32
 	#include <sys/select.h>
 	#define MM_API __attribute__((visibility ("default")))
+	#ifdef __linux__
+		#include <sys/epoll.h>
+		#include <sys/socket.h>
+		#include <sys/ioctl.h>
+		#include <linux/sockios.h>
+		#define MM_EPOLL
+	#endif
 #else
 	#include <fcntl.h>
 	#define MM_API __attribute__((dllexport))
@@ -18,6 +25,10 @@
 #include "routing.h"
 #include "plugin.h"
 #include "config.h"
+#include "timer.h"
+#include "thread.h"
+#include "stats.h"
+#include "log.h"
 
 static struct {
 	size_t n;
@@ -25,29 +36,97 @@ static struct {
 	managed_fd* fd;
 	managed_fd* signaled;
 	fd_set read;
+	#ifdef MM_EPOLL
+	int epoll_fd;
+	struct epoll_event* events;
+	#endif
 } fds = {
-	.max = -1
+	.max = -1,
+	#ifdef MM_EPOLL
+	.epoll_fd = -1
+	#endif
+};
+
+static enum {
+	mux_select = 0,
+	mux_epoll,
+	mux_epoll_edge
+} multiplexer =
+	#ifdef MM_EPOLL
+	mux_epoll;
+	#else
+	mux_select;
+	#endif
+
+//stop after loading the configuration and compiling the routing table
+static uint8_t load_only = 0;
+
+#define MM_LATENCY_BUCKETS 24
+static struct {
+	//busy-poll window after activity in microseconds, 0 to always block
+	uint32_t busy_poll;
+	uint64_t busy_until;
+	size_t busy_iterations;
+	uint8_t busy_poll_failed;
+
+	//receive-to-dispatch latency histogram, bucket n counts samples below 2^(n + 1) microseconds
+	uint8_t histogram;
+	uint64_t bucket[MM_LATENCY_BUCKETS];
+	uint64_t samples;
+	uint64_t total;
+	uint64_t max;
+} latency = {
+	0
 };
 
 static volatile sig_atomic_t fd_set_dirty = 1;
-static uint64_t global_timestamp = 0;
+//every thread running backend code keeps its own iteration timestamp
+static __thread uint64_t global_timestamp = 0, global_timestamp_ns = 0;
 
 MM_API uint64_t mm_timestamp(){
 	return global_timestamp;
 }
 
-static void core_timestamp(){
+MM_API uint64_t mm_timestamp_us(){
+	return global_timestamp_ns / 1000;
+}
+
+MM_API uint64_t mm_timestamp_ns(){
+	return global_timestamp_ns;
+}
+
+uint64_t core_clock(){
 	#ifdef _WIN32
-	global_timestamp = GetTickCount();
+	static LARGE_INTEGER frequency = {
+		.QuadPart = 0
+	};
+	LARGE_INTEGER current;
+
+	if(!frequency.QuadPart){
+		QueryPerformanceFrequency(&frequency);
+	}
+	QueryPerformanceCounter(&current);
+	return (current.QuadPart / frequency.QuadPart) * 1000000000
+		+ ((current.QuadPart % frequency.QuadPart) * 1000000000) / frequency.QuadPart;
 	#else
 	struct timespec current;
-	if(clock_gettime(CLOCK_MONOTONIC_COARSE, &current)){
+	if(clock_gettime(CLOCK_MONOTONIC, &current)){
+		return 0;
+	}
+	return ((uint64_t) current.tv_sec) * 1000000000 + current.tv_nsec;
+	#endif
+}
+
+void core_timestamp(){
+	uint64_t current = core_clock();
+
+	if(!current){
 		LOGPF("Failed to update global timestamp, time-based processing for some backends may be impaired: %s", strerror(errno));
 		return;
 	}
 
-	global_timestamp = current.tv_sec * 1000 + current.tv_nsec / 1000000;
-	#endif
+	global_timestamp_ns = current;
+	global_timestamp = global_timestamp_ns / 1000000;
 }
 
 static fd_set core_collect(int* max_fd){
@@ -72,19 +151,63 @@ static fd_set core_collect(int* max_fd){
 	return rv_fds;
 }
 
-MM_API int mm_manage_fd(int new_fd, char* back, int manage, void* impl){
-	backend* b = backend_match(back);
-	size_t u;
+#ifdef MM_EPOLL
+static int core_epoll_update(size_t slot, int op){
+	struct epoll_event ev = {
+		.events = EPOLLIN | ((multiplexer == mux_epoll_edge) ? EPOLLET : 0),
+		.data.u64 = slot
+	};
 
-	if(!b){
-		LOGPF("Unknown backend %s registered for managed fd", back);
+	if(fds.epoll_fd < 0){
+		return 0;
+	}
+
+	if(epoll_ctl(fds.epoll_fd, op, fds.fd[slot].fd, &ev)){
+		//descriptors closed before being unregistered have already been removed by the kernel
+		if(op == EPOLL_CTL_DEL && (errno == EBADF || errno == ENOENT)){
+			return 0;
+		}
+		//the descriptor number may have been closed and reused while still registered
+		if(op == EPOLL_CTL_MOD && errno == ENOENT){
+			return core_epoll_update(slot, EPOLL_CTL_ADD);
+		}
+		LOGPF("Failed to update epoll registration for descriptor %d: %s", fds.fd[slot].fd, strerror(errno));
 		return 1;
 	}
+	return 0;
+}
+
+static int core_epoll_start(){
+	size_t u;
+
+	fds.epoll_fd = epoll_create1(0);
+	if(fds.epoll_fd < 0){
+		LOGPF("Failed to create epoll instance, falling back to select: %s", strerror(errno));
+		multiplexer = mux_select;
+		return 0;
+	}
+
+	for(u = 0; u < fds.n; u++){
+		if(fds.fd[u].fd >= 0 && core_epoll_update(u, EPOLL_CTL_ADD)){
+			return 1;
+		}
+	}
+	return 0;
+}
+#endif
+
+static int core_manage_fd(int new_fd, backend* b, int manage, void* impl){
+	size_t u;
 
 	//find exact match
 	for(u = 0; u < fds.n; u++){
 		if(fds.fd[u].fd == new_fd && fds.fd[u].backend == b){
 			fds.fd[u].impl = impl;
+			#ifdef MM_EPOLL
+			if(core_epoll_update(u, manage ? EPOLL_CTL_MOD : EPOLL_CTL_DEL)){
+				return 1;
+			}
+			#endif
 			if(!manage){
 				fds.fd[u].fd = -1;
 				fds.fd[u].backend = NULL;
@@ -124,6 +247,14 @@ MM_API int mm_manage_fd(int new_fd, char* back, int manage, void* impl){
 			fds.n = 0;
 			return 1;
 		}
+
+		#ifdef MM_EPOLL
+		fds.events = realloc(fds.events, (fds.n + 1) * sizeof(struct epoll_event));
+		if(!fds.events){
+			LOG("Failed to allocate memory");
+			return 1;
+		}
+		#endif
 		fds.n++;
 	}
 
@@ -132,7 +263,116 @@ MM_API int mm_manage_fd(int new_fd, char* back, int manage, void* impl){
 	fds.fd[u].backend = b;
 	fds.fd[u].impl = impl;
 	fd_set_dirty = 1;
+	#ifdef MM_EPOLL
+	return core_epoll_update(u, EPOLL_CTL_ADD);
+	#else
 	return 0;
+	#endif
+}
+
+static void core_busy_poll(int fd){
+	#ifdef SO_BUSY_POLL
+	int window = latency.busy_poll;
+
+	//let the kernel poll the device queue for sockets as well, requires CAP_NET_ADMIN above net.core.busy_read
+	if(window && setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &window, sizeof(window))
+			&& errno != ENOTSOCK
+			&& !latency.busy_poll_failed){
+		LOGPF("Failed to enable socket busy polling, only polling in the core: %s", strerror(errno));
+		latency.busy_poll_failed = 1;
+	}
+	#endif
+}
+
+MM_API int mm_manage_fd(int new_fd, char* back, int manage, void* impl){
+	backend* b = backend_match(back);
+
+	if(!b){
+		LOGPF("Unknown backend %s registered for managed fd", back);
+		return 1;
+	}
+
+	if(manage){
+		core_busy_poll(new_fd);
+	}
+
+	//backends running on a worker thread multiplex their descriptors there
+	if(thread_managed(b)){
+		return thread_manage_fd(b, new_fd, manage, impl);
+	}
+
+	return core_manage_fd(new_fd, b, manage, impl);
+}
+
+int core_configure(char* option, char* value){
+	if(!strcmp(option, "multiplexer")){
+		if(!strcmp(value, "select")){
+			multiplexer = mux_select;
+			return 0;
+		}
+		#ifdef MM_EPOLL
+		else if(!strcmp(value, "epoll")){
+			multiplexer = mux_epoll;
+			return 0;
+		}
+		else if(!strcmp(value, "epoll-edge")){
+			multiplexer = mux_epoll_edge;
+			return 0;
+		}
+		#endif
+		LOGPF("Multiplexer %s is not supported on this platform", value);
+		return 1;
+	}
+	else if(!strcmp(option, "busy-poll")){
+		latency.busy_poll = strtoul(value, NULL, 10);
+		return 0;
+	}
+	else if(!strcmp(option, "latency-histogram")){
+		latency.histogram = !strcmp(value, "on");
+		return 0;
+	}
+	else if(!strcmp(option, "log-buffer") || !strcmp(option, "log-rate")){
+		return log_configure(option, value);
+	}
+	else if(!strcmp(option, "load-only")){
+		load_only = !strcmp(value, "on");
+		return 0;
+	}
+	else if(!strcmp(option, "bulk-ranges")){
+		return config_configure(option, value);
+	}
+	else if(!strcmp(option, "stats-interval")){
+		return stats_configure(option, value);
+	}
+	else if(!strcmp(option, "coalesce") || !strcmp(option, "queue-limit")){
+		return routing_configure(option, value);
+	}
+	else if(!strcmp(option, "thread")
+			|| !strcmp(option, "scheduler")
+			|| !strcmp(option, "priority")
+			|| !strcmp(option, "memory-lock")
+			|| !strcmp(option, "affinity")
+			|| !strcmp(option, "thread-affinity")){
+		return threads_configure(option, value);
+	}
+	else if(!strcmp(option, "plugins")){
+		if(!strcmp(value, "lazy")){
+			return 0;
+		}
+		else if(!strcmp(value, "eager")){
+			//attach everything in the plugin directory right away
+			if(plugins_load()){
+				LOG("Failed to initialize a backend");
+				return 1;
+			}
+			return 0;
+		}
+		LOGPF("Unknown plugin loading mode %s", value);
+		return 1;
+	}
+
+	LOGPF("Unknown core configuration option %s", option);
+	return 1;
 }
 
 int core_initialize(){
@@ -150,29 +390,257 @@ int core_initialize(){
 	_fmode = _O_BINARY;
 	#endif
 
-	//attach plugins
-	if(plugins_load(PLUGINS)){
-		LOG("Failed to initialize a backend");
+	//plugins are attached on demand while reading the configuration
+	if(plugins_initialize(PLUGINS)){
 		return 1;
 	}
-
 	return 0;
 }
 
+backend* core_backend(char* name){
+	backend* b = backend_match(name);
+
+	//try to attach the plugin providing the backend
+	if(!b){
+		if(plugins_attach(name)){
+			return NULL;
+		}
+		b = backend_match(name);
+	}
+	return b;
+}
+
 int core_start(){
+	size_t u;
+
+	//move logging off the event loop before any threads are started
+	if(log_start()){
+		return 1;
+	}
+
+	//the backends are not started, so nothing is connected and the core_iteration() loop is skipped
+	if(load_only){
+		if(routing_compile()){
+			return 1;
+		}
+		routing_stats();
+		LOG("Configuration loaded, not starting backends (load-only)");
+		return 0;
+	}
+
+	//set up worker threads before the backends register their descriptors and timers on start
+	if(threads_prepare()){
+		return 1;
+	}
+
+	//descriptors registered before the core options were read have not been configured for busy polling yet
+	for(u = 0; u < fds.n; u++){
+		if(fds.fd[u].fd >= 0){
+			core_busy_poll(fds.fd[u].fd);
+		}
+	}
+
+	//hand over descriptors registered during configuration
+	for(u = 0; u < fds.n; u++){
+		if(fds.fd[u].fd >= 0 && thread_managed(fds.fd[u].backend)){
+			if(thread_manage_fd(fds.fd[u].backend, fds.fd[u].fd, 1, fds.fd[u].impl)){
+				return 1;
+			}
+			fds.fd[u].fd = -1;
+			fds.fd[u].backend = NULL;
+			fds.fd[u].impl = NULL;
+			fd_set_dirty = 1;
+		}
+	}
+
+	//the wake-up descriptor signals events generated on worker threads or injected asynchronously
+	if(thread_wake_fd() >= 0 && core_manage_fd(thread_wake_fd(), NULL, 1, NULL)){
+		return 1;
+	}
+
 	if(backends_start()){
 		return 1;
 	}
 
+	//freeze the configured mappings into the flat routing table
+	if(routing_compile()){
+		return 1;
+	}
 	routing_stats();
 
+	if(threads_start()){
+		return 1;
+	}
+
+	//apply scheduling options to the main loop after the workers have been started, so they do not inherit them
+	threads_realtime();
+
 	if(!fds.n){
 		LOG("No descriptors registered for multiplexing");
 	}
 
+	#ifdef MM_EPOLL
+	if(multiplexer != mux_select){
+		return core_epoll_start();
+	}
+	#endif
+	return 0;
+}
+
+static struct timeval core_timeout(){
+	struct timeval tv = backend_timeout();
+	uint32_t next = timers_next(0);
+
+	//keep checking for new data without blocking within the busy-poll window
+	if(latency.busy_poll && global_timestamp_ns < latency.busy_until){
+		latency.busy_iterations++;
+		tv.tv_sec = tv.tv_usec = 0;
+		return tv;
+	}
+
+	//wake up for the next timer deadline if it precedes the backend interval
+	if(next < tv.tv_sec * 1000 + tv.tv_usec / 1000){
+		tv.tv_sec = next / 1000;
+		tv.tv_usec = (next % 1000) * 1000;
+	}
+	return tv;
+}
+
+static void core_latency_sample(uint64_t sample){
+	size_t bucket = 0;
+	uint64_t usec = sample / 1000;
+
+	for(usec >>= 1; usec && bucket < MM_LATENCY_BUCKETS - 1; usec >>= 1){
+		bucket++;
+	}
+
+	latency.bucket[bucket]++;
+	latency.samples++;
+	latency.total += sample;
+	latency.max = max(latency.max, sample);
+}
+
+static void core_latency(size_t n){
+	#if defined(MM_EPOLL) && defined(SIOCGSTAMPNS)
+	struct timespec now, received;
+	uint64_t now_ns, received_ns;
+	size_t u;
+
+	//measure from the kernel receive timestamp of the last datagram read from each signaled socket
+	//to the point where all resulting events have been handed to the output backends.
+	//for backends reading batches, older datagrams of the same batch are not sampled, so this is a lower bound
+	if(clock_gettime(CLOCK_REALTIME, &now)){
+		return;
+	}
+	now_ns = ((uint64_t) now.tv_sec) * 1000000000 + now.tv_nsec;
+
+	for(u = 0; u < n; u++){
+		//the first query enables timestamping on the socket and fails
+		if(fds.signaled[u].backend && !ioctl(fds.signaled[u].fd, SIOCGSTAMPNS, &received)){
+			received_ns = ((uint64_t) received.tv_sec) * 1000000000 + received.tv_nsec;
+			if(received_ns <= now_ns){
+				core_latency_sample(now_ns - received_ns);
+			}
+		}
+	}
+	#else
+	//without receive timestamps, measure from the wake-up of the core
+	//read the clock directly, the iteration timestamp must stay constant within the iteration
+	core_latency_sample(core_clock() - global_timestamp_ns);
+	#endif
+}
+
+static void core_latency_report(){
+	size_t u;
+	uint64_t count = 0;
+	#if defined(MM_EPOLL) && defined(SIOCGSTAMPNS)
+	char* origin = "Receive";
+	#else
+	char* origin = "Wake-up";
+	#endif
+
+	if(latency.busy_poll){
+		LOGPF("Busy-polled for %" PRIsize_t " iterations", latency.busy_iterations);
+	}
+
+	if(!latency.histogram || !latency.samples){
+		return;
+	}
+
+	LOGPF("%s-to-dispatch latency over %" PRIu64 " samples: average %" PRIu64 " usec, maximum %" PRIu64 " usec",
+			origin, latency.samples, latency.total / latency.samples / 1000, latency.max / 1000);
+	for(u = 0; u < MM_LATENCY_BUCKETS; u++){
+		if(latency.bucket[u]){
+			count += latency.bucket[u];
+			LOGPF("\t< %8" PRIu64 " usec: %10" PRIu64 " (%5.1f%% cumulative)",
+					((uint64_t) 2) << u, latency.bucket[u], (100.0 * count) / latency.samples);
+		}
+	}
+}
+
+static int core_process(size_t n){
+	//run expired timers
+	if(timers_process(0)){
+		return 1;
+	}
+
+	//pick up events generated on worker threads
+	if(threads_collect()){
+		return 1;
+	}
+
+	//run backend processing to collect events
+	DBGPF("%" PRIsize_t " backend FDs signaled", n);
+	if(backends_handle(n, fds.signaled)){
+		return 1;
+	}
+
+	//route generated events
+	if(routing_iteration()){
+		return 1;
+	}
+	stats_iteration(global_timestamp_ns);
+
+	if(n){
+		//spin for a while after activity, as more input is likely to follow
+		if(latency.busy_poll){
+			latency.busy_until = global_timestamp_ns + latency.busy_poll * 1000ull;
+		}
+
+		if(latency.histogram){
+			core_latency(n);
+		}
+	}
 	return 0;
 }
 
+#ifdef MM_EPOLL
+static int core_iteration_epoll(){
+	struct timeval tv = core_timeout();
+	int ready, u;
+	size_t n = 0;
+
+	ready = epoll_wait(fds.epoll_fd, fds.events, fds.n, tv.tv_sec * 1000 + tv.tv_usec / 1000);
+	if(ready < 0){
+		LOGPF("epoll_wait failed: %s", strerror(errno));
+		return 1;
+	}
+
+	//update this iteration's timestamp
+	core_timestamp();
+
+	//the event payload carries the slot index, so only ready descriptors are touched
+	for(u = 0; u < ready; u++){
+		if(fds.fd[fds.events[u].data.u64].fd >= 0){
+			fds.signaled[n] = fds.fd[fds.events[u].data.u64];
+			n++;
+		}
+	}
+
+	return core_process(n);
+}
+#endif
+
 int core_iteration(){
 	fd_set read_fds;
 	struct timeval tv;
@@ -184,6 +652,12 @@ int core_iteration(){
 	struct timespec ts;
 	#endif
 
+	#ifdef MM_EPOLL
+	if(fds.epoll_fd >= 0 && fds.n){
+		return core_iteration_epoll();
+	}
+	#endif
+
 	//rebuild fd set if necessary
 	if(fd_set_dirty){
 		fds.read = core_collect(&(fds.max));
@@ -192,7 +666,7 @@ int core_iteration(){
 
 	//wait for & translate events
 	read_fds = fds.read;
-	tv = backend_timeout();
+	tv = core_timeout();
 
 	//check whether there are any fds active, windows does not like select() without descriptors
 	if(fds.max >= 0){
@@ -233,14 +707,7 @@ int core_iteration(){
 		}
 	}
 
-	//run backend processing to collect events
-	DBGPF("%" PRIsize_t " backend FDs signaled", n);
-	if(backends_handle(n, fds.signaled)){
-		return 1;
-	}
-
-	//route generated events
-	return routing_iteration();
+	return core_process(n);
 }
 
 static void fds_free(){
@@ -252,6 +719,15 @@ static void fds_free(){
 		}
 	}
 
+	#ifdef MM_EPOLL
+	if(fds.epoll_fd >= 0){
+		close(fds.epoll_fd);
+		fds.epoll_fd = -1;
+	}
+	free(fds.events);
+	fds.events = NULL;
+	#endif
+
 	fds.max = -1;
 	free(fds.signaled);
 	fds.signaled = NULL;
@@ -260,11 +736,34 @@ static void fds_free(){
 	fds.n = 0;
 }
 
+int core_load_only(){
+	return load_only;
+}
+
 void core_shutdown(){
+	core_latency_report();
+	memset(&latency.bucket, 0, sizeof(latency.bucket));
+	latency.samples = latency.total = latency.max = 0;
+	latency.busy_iterations = 0;
+
+	//stop worker threads first, shutdown callbacks for their backends run on the main thread
+	threads_stop();
+	routing_report();
+	stats_cleanup();
 	backends_stop();
+	timers_cleanup();
 	routing_cleanup();
+
+	//the wake-up descriptor is owned by the thread module
+	if(thread_wake_fd() >= 0){
+		core_manage_fd(thread_wake_fd(), NULL, 0, NULL);
+	}
+	threads_cleanup();
 	fds_free();
 	plugins_close();
 	config_free();
 	fd_set_dirty = 1;
+
+	//write out any buffered messages, including those from backend shutdown callbacks
+	log_stop();
 }
@@ -12,10 +12,13 @@
  * 		This allows the frontend to configure overrides for any configuration
  * 		loaded later (e.g. by parsing command line arguments) before initializing
  * 		the core.
- * 	* Calling core_initialize() attaches all backend modules to the system and
- * 		performs platform specific startup operations. From this point on,
+ * 	* Calling core_initialize() performs platform specific startup operations.
+ * 		Backend modules are attached when first requested via core_backend()
+ * 		(or all at once with the `plugins = eager` core option). From this point on,
  * 		core_shutdown() must be called before terminating the frontend.
  * 		All frontend API calls except `core_iteration` are now valid.
+ * 		Options for the core itself are passed via core_configure() (usually
+ * 		called while parsing the `[core]` configuration section).
  * 		The core is now in the configuration stage in which the frontend
  * 		will push any configuration files.
  * 	* Calling core_start() marks the transition from the configuration phase
@@ -24,6 +27,9 @@
  * 		sources and sinks. In this stage, only the following API calls are valid:
  * 			core_iteration()
  * 			core_shutdown()
+ * 		With the `load-only` core option, core_start() only compiles the routing
+ * 		table and core_load_only() returns nonzero. The frontend then skips
+ * 		core_iteration() and calls core_shutdown() directly.
  * 	* The frontend will now repeatedly call core_iteration() to process any incoming
  * 		events. This API will block execution until either one or more events have
  * 		been registered or an internal timeout expires.
@@ -34,10 +40,17 @@
  */
 
 int core_initialize();
+int core_configure(char* option, char* value);
+backend* core_backend(char* name);
+void core_timestamp();
+uint64_t core_clock();
 int core_start();
+int core_load_only();
 int core_iteration();
 void core_shutdown();
 
 /* Public backend API */
 MM_API uint64_t mm_timestamp();
+MM_API uint64_t mm_timestamp_us();
+MM_API uint64_t mm_timestamp_ns();
 MM_API int mm_manage_fd(int new_fd, char* back, int manage, void* impl);
@@ -0,0 +1,321 @@
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>
+#ifndef _WIN32
+	#include <pthread.h>
+	#include <poll.h>
+	#include <fcntl.h>
+	#define MM_API __attribute__((visibility ("default")))
+#else
+	#define MM_API __attribute__((dllexport))
+#endif
+
+#define BACKEND_NAME "core/log"
+#define MM_LOG_LINE 512
+#define MM_LOG_SITES 256
+#define MM_LOG_BATCH 16384
+#define MM_LOG_INTERVAL 100
+#include "midimonster.h"
+#include "core.h"
+#include "log.h"
+
+//formatted message, published to the writer thread
+typedef struct /*_mm_log_line*/ {
+	size_t sequence;
+	size_t length;
+	char text[MM_LOG_LINE];
+} log_line;
+
+//rate limiting state for a call site, identified by its format string
+typedef struct /*_mm_log_site*/ {
+	char* fmt;
+	uint64_t window;
+	size_t count;
+	size_t suppressed;
+} log_site;
+
+static struct {
+	//number of buffered lines, 0 to write synchronously
+	size_t size;
+	//messages per call site and second, 0 to disable rate limiting
+	size_t rate;
+
+	//claimed by the producers
+	size_t head;
+	//only written by the writer thread
+	size_t tail;
+	uint8_t pending;
+	uint8_t active;
+	uint8_t shutdown;
+	log_line* line;
+
+	size_t dropped;
+	size_t dropped_total;
+	size_t suppressed;
+	log_site site[MM_LOG_SITES];
+	#ifndef _WIN32
+	pthread_t thread;
+	int wake[2];
+	#endif
+} logging = {
+	.size = 1024,
+	#ifndef _WIN32
+	.wake = {-1, -1}
+	#endif
+};
+
+int log_configure(char* option, char* value){
+	if(!strcmp(option, "log-buffer")){
+		logging.size = strtoul(value, NULL, 10);
+		return 0;
+	}
+	else if(!strcmp(option, "log-rate")){
+		logging.rate = strtoul(value, NULL, 10);
+		return 0;
+	}
+
+	LOGPF("Unknown logging option %s", option);
+	return 1;
+}
+
+//returns 1 if the message exceeds the rate limit, previously suppressed messages are reported via the second argument
+static int log_limit(char* fmt, size_t* suppressed){
+	log_site* site = NULL;
+	uint64_t window;
+
+	if(!logging.rate){
+		return 0;
+	}
+
+	//concurrent callers may race on a slot, which only affects the accuracy of the count
+	site = logging.site + (((uintptr_t) fmt >> 3) % MM_LOG_SITES);
+	window = core_clock() / 1000000000;
+	if(__atomic_load_n(&site->fmt, __ATOMIC_RELAXED) != fmt){
+		//another call site took over the slot
+		__atomic_store_n(&site->fmt, fmt, __ATOMIC_RELAXED);
+		__atomic_store_n(&site->window, window, __ATOMIC_RELAXED);
+		__atomic_store_n(&site->count, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&site->suppressed, 0, __ATOMIC_RELAXED);
+	}
+	else if(__atomic_load_n(&site->window, __ATOMIC_RELAXED) != window){
+		__atomic_store_n(&site->window, window, __ATOMIC_RELAXED);
+		__atomic_store_n(&site->count, 0, __ATOMIC_RELAXED);
+		*suppressed = __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_RELAXED);
+	}
+
+	if(__atomic_fetch_add(&site->count, 1, __ATOMIC_RELAXED) >= logging.rate){
+		__atomic_fetch_add(&site->suppressed, 1, __ATOMIC_RELAXED);
+		__atomic_fetch_add(&logging.suppressed, 1, __ATOMIC_RELAXED);
+		return 1;
+	}
+	return 0;
+}
+
+static void log_wake(){
+	#ifndef _WIN32
+	uint8_t token = 1;
+	//a full pipe already guarantees a wake-up
+	if(write(logging.wake[1], &token, sizeof(token)) < 0 && errno != EAGAIN){
+		fprintf(stderr, "%s\tFailed to wake up log writer: %s\n", BACKEND_NAME, strerror(errno));
+	}
+	#endif
+}
+
+static int log_emit(int level, char* module, char* fmt, va_list args){
+	size_t head = __atomic_load_n(&logging.head, __ATOMIC_RELAXED), sequence, prefix;
+	log_line* slot = NULL;
+	int rv = 0;
+
+	if(!__atomic_load_n(&logging.active, __ATOMIC_ACQUIRE)){
+		fprintf(stderr, "%s%s\t", level ? "debug/" : "", module);
+		return vfprintf(stderr, fmt, args);
+	}
+
+	//claim a slot, retrying if another producer got there first
+	for(;;){
+		slot = logging.line + (head % logging.size);
+		sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+		if(sequence == head){
+			if(__atomic_compare_exchange_n(&logging.head, &head, head + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+				break;
+			}
+		}
+		else if((ssize_t) (sequence - head) < 0){
+			//the writer has not caught up yet, never block the caller
+			__atomic_fetch_add(&logging.dropped, 1, __ATOMIC_RELAXED);
+			return 0;
+		}
+		else{
+			head = __atomic_load_n(&logging.head, __ATOMIC_RELAXED);
+		}
+	}
+
+	prefix = min(snprintf(slot->text, MM_LOG_LINE, "%s%s\t", level ? "debug/" : "", module), MM_LOG_LINE - 1);
+	rv = vsnprintf(slot->text + prefix, MM_LOG_LINE - prefix, fmt, args);
+	slot->length = prefix + max(rv, 0);
+	if(slot->length >= MM_LOG_LINE){
+		//mark truncated messages
+		memcpy(slot->text + MM_LOG_LINE - 5, "...\n", 5);
+		slot->length = MM_LOG_LINE - 1;
+	}
+	__atomic_store_n(&slot->sequence, head + 1, __ATOMIC_RELEASE);
+
+	//only the first message after the writer last checked needs to wake it up
+	if(!__atomic_exchange_n(&logging.pending, 1, __ATOMIC_SEQ_CST)){
+		log_wake();
+	}
+	return rv;
+}
+
+static int log_note(int level, char* module, char* fmt, ...){
+	int rv = 0;
+	va_list args;
+	va_start(args, fmt);
+	rv = log_emit(level, module, fmt, args);
+	va_end(args);
+	return rv;
+}
+
+int log_vprintf(int level, char* module, char* fmt, va_list args){
+	size_t suppressed = 0;
+
+	if(log_limit(fmt, &suppressed)){
+		return 0;
+	}
+
+	if(suppressed){
+		log_note(level, module, "%" PRIsize_t " similar messages were suppressed\n", suppressed);
+	}
+	return log_emit(level, module, fmt, args);
+}
+
+#ifndef _WIN32
+static void log_drain(){
+	char batch[MM_LOG_BATCH];
+	size_t fill = 0, dropped;
+	log_line* slot = NULL;
+
+	for(;; logging.tail++){
+		slot = logging.line + (logging.tail % logging.size);
+		if(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != logging.tail + 1){
+			break;
+		}
+
+		//coalesce lines into as few writes as possible
+		if(fill + slot->length > sizeof(batch)){
+			fwrite(batch, 1, fill, stderr);
+			fill = 0;
+		}
+		memcpy(batch + fill, slot->text, slot->length);
+		fill += slot->length;
+		__atomic_store_n(&slot->sequence, logging.tail + logging.size, __ATOMIC_RELEASE);
+	}
+
+	if(fill){
+		fwrite(batch, 1, fill, stderr);
+	}
+
+	dropped = __atomic_exchange_n(&logging.dropped, 0, __ATOMIC_RELAXED);
+	if(dropped){
+		fprintf(stderr, "%s\tLog buffer full, dropped %" PRIsize_t " messages\n", BACKEND_NAME, dropped);
+		logging.dropped_total += dropped;
+	}
+	fflush(stderr);
+}
+
+static void* log_writer(void* arg){
+	struct pollfd wake = {
+		.fd = logging.wake[0],
+		.events = POLLIN
+	};
+	uint8_t shutdown = 0;
+	char buffer[64];
+
+	while(!shutdown){
+		poll(&wake, 1, MM_LOG_INTERVAL);
+		while(read(logging.wake[0], buffer, sizeof(buffer)) > 0){
+		}
+
+		//messages published before the shutdown request are still written
+		shutdown = __atomic_load_n(&logging.shutdown, __ATOMIC_ACQUIRE);
+		__atomic_exchange_n(&logging.pending, 0, __ATOMIC_SEQ_CST);
+		log_drain();
+	}
+	return NULL;
+}
+#endif
+
+int log_start(){
+	#ifndef _WIN32
+	size_t u;
+
+	if(!logging.size){
+		return 0;
+	}
+
+	logging.line = calloc(logging.size, sizeof(log_line));
+	if(!logging.line){
+		LOG("Failed to allocate memory");
+		return 1;
+	}
+
+	//each slot carries the position it may next be claimed at
+	for(u = 0; u < logging.size; u++){
+		logging.line[u].sequence = u;
+	}
+	logging.head = logging.tail = 0;
+	logging.pending = logging.shutdown = 0;
+
+	if(pipe(logging.wake)){
+		LOGPF("Failed to create log writer wake-up pipe: %s", strerror(errno));
+		return 1;
+	}
+
+	if(fcntl(logging.wake[0], F_SETFL, O_NONBLOCK) || fcntl(logging.wake[1], F_SETFL, O_NONBLOCK)){
+		LOGPF("Failed to set log writer wake-up pipe to non-blocking mode: %s", strerror(errno));
+		return 1;
+	}
+
+	if(pthread_create(&logging.thread, NULL, log_writer, NULL)){
+		LOG("Failed to start log writer thread");
+		return 1;
+	}
+
+	__atomic_store_n(&logging.active, 1, __ATOMIC_RELEASE);
+	#endif
+	return 0;
+}
+
+void log_stop(){
+	#ifndef _WIN32
+	if(logging.active){
+		//messages logged from here on are written synchronously again
+		__atomic_store_n(&logging.active, 0, __ATOMIC_SEQ_CST);
+		__atomic_store_n(&logging.shutdown, 1, __ATOMIC_RELEASE);
+		log_wake();
+		pthread_join(logging.thread, NULL);
+	}
+
+	if(logging.wake[0] >= 0){
+		close(logging.wake[0]);
+		close(logging.wake[1]);
+	}
+	logging.wake[0] = logging.wake[1] = -1;
+	free(logging.line);
+	logging.line = NULL;
+	#endif
+
+	if(logging.dropped_total){
+		LOGPF("Dropped %" PRIsize_t " messages due to a full log buffer", logging.dropped_total);
+	}
+
+	if(logging.suppressed){
+		LOGPF("Suppressed %" PRIsize_t " messages exceeding the log rate limit", logging.suppressed);
+	}
+
+	logging.dropped_total = logging.suppressed = 0;
+	logging.size = 1024;
+	logging.rate = 0;
+	memset(logging.site, 0, sizeof(logging.site));
+}
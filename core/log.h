@@ -0,0 +1,14 @@
+/*
+ * Messages passed to log_vprintf() are formatted into a lock-free ring and
+ * written by a dedicated thread while the core is running, so logging never
+ * blocks the event loop on a slow output. Before core_start() and after
+ * core_shutdown(), messages are written synchronously.
+ */
+
+/* Frontend API */
+int log_vprintf(int level, char* module, char* fmt, va_list args);
+
+/* Internal API */
+int log_configure(char* option, char* value);
+int log_start();
+void log_stop();
@@ -19,15 +19,73 @@
 
 #define BACKEND_NAME "core/pl"
 #include "midimonster.h"
+#include "core.h"
 #include "plugin.h"
 
 static size_t plugins = 0;
 static void** plugin_handle = NULL;
+static char* plugin_path = NULL;
+
+#ifdef MM_STATIC_PLUGINS
+/*
+ * Backends linked into a monolithic build export their entry point as
+ * <name>_init. MM_STATIC_PLUGINS is set by the build system to a list of
+ * MM_STATIC_PLUGIN(<name>) entries.
+ */
+#define MM_STATIC_PLUGIN(plugin) int plugin ## _init();
+MM_STATIC_PLUGINS
+#undef MM_STATIC_PLUGIN
+
+#define MM_STATIC_PLUGIN(plugin) {.name = #plugin, .init = plugin ## _init},
+static struct {
+	char* name;
+	plugin_init init;
+	uint8_t attached;
+} plugin_static[] = {
+	MM_STATIC_PLUGINS
+	{0}
+};
+#undef MM_STATIC_PLUGIN
+#endif
+
+#ifdef MM_STATIC_PLUGINS
+static ssize_t plugin_static_find(char* name, size_t length){
+	ssize_t u;
+	for(u = 0; plugin_static[u].name; u++){
+		if(strlen(plugin_static[u].name) == length && !strncmp(plugin_static[u].name, name, length)){
+			return u;
+		}
+	}
+	return -1;
+}
+
+static int plugin_static_attach(size_t u){
+	uint64_t load_start = core_clock();
+
+	if(plugin_static[u].attached){
+		return 0;
+	}
+
+	if(plugin_static[u].init()){
+		LOGPF("Built-in backend %s failed to initialize", plugin_static[u].name);
+		return 1;
+	}
+
+	plugin_static[u].attached = 1;
+	LOGPF("Attached built-in backend %s in %" PRIu64 " usec", plugin_static[u].name, (core_clock() - load_start) / 1000);
+	return 0;
+}
+#endif
 
 static int plugin_attach(char* path, char* file){
 	plugin_init init = NULL;
 	void* handle = NULL;
 	char* lib = NULL;
+	size_t u;
+	uint64_t load_start = core_clock(), load_done;
+	#ifdef MM_STATIC_PLUGINS
+	ssize_t builtin;
+	#endif
 	#ifdef _WIN32
 	char* path_separator = "\\";
 	#else
@@ -39,6 +97,13 @@ static int plugin_attach(char* path, char* file){
 		return 1;
 	}
 
+	#ifdef MM_STATIC_PLUGINS
+	//prefer the linked-in version of a backend over the shared object
+	if(strrchr(file, '.') && (builtin = plugin_static_find(file, strrchr(file, '.') - file)) >= 0){
+		return plugin_static_attach(builtin);
+	}
+	#endif
+
 	lib = calloc(strlen(path) + strlen(file) + 2, sizeof(char));
 	if(!lib){
 		LOG("Failed to allocate memory");
@@ -64,6 +129,16 @@ static int plugin_attach(char* path, char* file){
 		return 0;
 	}
 
+	//plugins may be requested multiple times, only initialize them once
+	for(u = 0; u < plugins; u++){
+		if(plugin_handle[u] == handle){
+			DBGPF("Plugin %s already attached", lib);
+			dlclose(handle);
+			free(lib);
+			return 0;
+		}
+	}
+
 	init = (plugin_init) dlsym(handle, "init");
 	if(init){
 		if(init()){
@@ -78,6 +153,9 @@ static int plugin_attach(char* path, char* file){
 		free(lib);
 		return 0;
 	}
+
+	load_done = core_clock();
+	LOGPF("Attached plugin %s in %" PRIu64 " usec", lib, (load_done - load_start) / 1000);
 	free(lib);
 
 	plugin_handle = realloc(plugin_handle, (plugins + 1) * sizeof(void*));
@@ -93,16 +171,50 @@ static int plugin_attach(char* path, char* file){
 	return 0;
 }
 
-int plugins_load(char* path){
+int plugins_initialize(char* path){
+	//configuration parsing changes the working directory, so resolve the search path up front
+	#ifdef _WIN32
+	plugin_path = _fullpath(NULL, path, 0);
+	#else
+	plugin_path = realpath(path, NULL);
+	#endif
+	if(!plugin_path){
+		#ifdef MM_STATIC_PLUGINS
+		LOGPF("Plugin search path %s not available, only built-in backends can be used", path);
+		return 0;
+		#else
+		LOGPF("Failed to resolve plugin search path %s: %s", path, strerror(errno));
+		return 1;
+		#endif
+	}
+	return 0;
+}
+
+int plugins_load(){
 	int rv = -1;
+	char* path = plugin_path;
+
+	#ifdef MM_STATIC_PLUGINS
+	size_t u;
+	for(u = 0; plugin_static[u].name; u++){
+		if(plugin_static_attach(u)){
+			return 1;
+		}
+	}
+
+	if(!path){
+		return 0;
+	}
+	#endif
 
 #ifdef _WIN32
-	char* search_expression = calloc(strlen(path) + strlen("*.dll") + 1, sizeof(char));
+	char* search_expression = calloc(strlen(path) + strlen("\\*.dll") + 1, sizeof(char));
 	if(!search_expression){
 		LOG("Failed to allocate memory");
 		return -1;
 	}
-	snprintf(search_expression, strlen(path) + strlen("*.dll") + 1, "%s*.dll", path);
+	snprintf(search_expression, strlen(path) + strlen("\\*.dll") + 1, "%s%s*.dll", path,
+			(path[strlen(path) - 1] == '\\') ? "" : "\\");
 	DBGPF("FindFirstFile search expression: %s", search_expression);
 
 	WIN32_FIND_DATA result;
@@ -166,6 +278,45 @@ load_done:
 #endif
 }
 
+int plugins_attach(char* name){
+	int rv = 0;
+	#ifdef _WIN32
+	char* suffix = ".dll";
+	#else
+	char* suffix = ".so";
+	#endif
+	char* file = NULL;
+
+	#ifdef MM_STATIC_PLUGINS
+	ssize_t builtin = plugin_static_find(name, strlen(name));
+	if(builtin >= 0){
+		return plugin_static_attach(builtin);
+	}
+
+	if(!plugin_path){
+		return 0;
+	}
+	#endif
+
+	//backend names never contain path components
+	if(strchr(name, '/') || strchr(name, '\\')){
+		LOGPF("Invalid backend name %s", name);
+		return 0;
+	}
+
+	file = calloc(strlen(name) + strlen(suffix) + 1, sizeof(char));
+	if(!file){
+		LOG("Failed to allocate memory");
+		return 1;
+	}
+
+	//plugins are expected to be named after the backend they provide
+	snprintf(file, strlen(name) + strlen(suffix) + 1, "%s%s", name, suffix);
+	rv = plugin_attach(plugin_path, file);
+	free(file);
+	return rv;
+}
+
 int plugins_close(){
 	size_t u;
 
@@ -187,6 +338,16 @@ int plugins_close(){
 	}
 
 	free(plugin_handle);
+	plugin_handle = NULL;
 	plugins = 0;
+
+	free(plugin_path);
+	plugin_path = NULL;
+
+	#ifdef MM_STATIC_PLUGINS
+	for(u = 0; plugin_static[u].name; u++){
+		plugin_static[u].attached = 0;
+	}
+	#endif
 	return 0;
 }
@@ -1,5 +1,7 @@
 typedef int (*plugin_init)();
 
 /* Internal API */
-int plugins_load(char* dir);
+int plugins_initialize(char* dir);
+int plugins_load();
+int plugins_attach(char* name);
 int plugins_close();
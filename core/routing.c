@@ -12,146 +12,916 @@
 
 #define BACKEND_NAME "core/rt"
 #define MM_SWAP_LIMIT 20
+#define MM_NO_COALESCE ((size_t) -1)
+//default upper bound for the number of events queued per target instance and iteration
+#define MM_QUEUE_LIMIT 65536
+#define MM_QUEUE_MINIMUM 16
+//limits for reporting mapping loops detected at compile time
+#define MM_LOOP_REPORT_LIMIT 10
+#define MM_LOOP_PATH_LIMIT 8
 #include "midimonster.h"
 #include "routing.h"
+#include "thread.h"
 #include "backend.h"
+#include "stats.h"
 
 /* Core-internal structures */
-typedef struct /*_event_collection*/ {
+typedef struct /*_event_queue*/ {
 	size_t alloc;
 	size_t n;
 	channel** channel;
 	channel_value* value;
+} event_queue;
+
+//events are collected into one queue per target instance, indexed by the stable queue index of the instance
+typedef struct /*_event_collection*/ {
+	uint64_t generation;
+	size_t n;
+	size_t queues;
+	event_queue* queue;
 } event_collection;
 
+typedef struct /*_mm_queue_slot*/ {
+	instance* instance;
+	size_t queue;
+} queue_slot;
+
 typedef struct /*_mm_channel_mapping*/ {
 	channel* from;
 	size_t destinations;
 	channel** to;
 } channel_mapping;
 
+//flattened (compressed sparse row) mapping table, indexed by channel->route - 1
+typedef struct /*_mm_routing_table*/ {
+	size_t sources;
+	channel** source;
+	size_t* offset;
+	channel** target;
+	//target queue index for each entry in target
+	size_t* queue;
+	//coalescing slot for each entry in target, MM_NO_COALESCE if the target instance does not coalesce
+	size_t* slot;
+	//per coalescing slot: queue position of the latest event and the collection generation it is valid for
+	size_t slots;
+	size_t* slot_position;
+	uint64_t* slot_generation;
+	//topological dispatch rank per queue index and queue indices in dispatch order
+	size_t* rank;
+	size_t* order;
+	size_t loops;
+	uint64_t build_usec;
+} routing_table;
+
 static struct {
-	//routing_hash is set up for 256 buckets
-	size_t entries[256];
-	channel_mapping* map[256];
+	//mappings are staged in order of creation until they are compiled into the table,
+	//with an open-addressing map from source channel to staged position + 1
+	size_t mappings;
+	size_t mappings_alloc;
+	channel_mapping* map;
+	size_t map_index_alloc;
+	size_t* map_index;
+	uint8_t dirty;
+	routing_table table;
+
+	//target instances in order of queue index, with an open-addressing map from instance to index
+	size_t instances;
+	instance** instance;
+	uint8_t* coalesce;
+	//per queue index: capacity bound (at least the in-degree) and events dropped at it
+	size_t* limit;
+	uint64_t* drops;
+	size_t queue_map_alloc;
+	queue_slot* queue_map;
+
+	//names of instances that collapse repeated events per iteration
+	size_t coalesce_names;
+	char** coalesce_name;
+	uint64_t generation;
+	uint64_t coalesced;
+
+	//events enqueued to target instances and event collector swaps
+	uint64_t routed;
+	uint64_t swaps;
+
+	//queue capacity bound and back-pressure statistics
+	size_t queue_limit;
+	size_t high_water;
+	uint64_t dropped;
 
 	event_collection pool[2];
 	event_collection* events;
+	//collection currently being dispatched and the rank of the instance being handled
+	event_collection* dispatching;
+	size_t dispatch_rank;
 } routing = {
+	.queue_limit = MM_QUEUE_LIMIT,
 	.events = routing.pool
 };
 
+static uint64_t routing_mix(uint64_t repr){
+	repr ^= repr >> 33;
+	repr *= 0xFF51AFD7ED558CCDULL;
+	repr ^= repr >> 33;
+	return repr;
+}
+
 static size_t routing_hash(channel* key){
-	uint64_t repr = (uint64_t) key;
-	//return 8bit hash for 256 buckets, not ideal but it works
-	return (repr ^ (repr >> 8) ^ (repr >> 16) ^ (repr >> 24) ^ (repr >> 32)) & 0xFF;
+	return routing_mix((uint64_t) key) & (routing.map_index_alloc - 1);
+}
+
+static int routing_map_grow(){
+	size_t u, slot, old_alloc = routing.map_index_alloc;
+	size_t* old = routing.map_index;
+	channel_mapping* map = realloc(routing.map, (routing.mappings_alloc ? routing.mappings_alloc * 2 : 64) * sizeof(channel_mapping));
+
+	if(!map){
+		LOG("Failed to allocate memory");
+		return 1;
+	}
+	routing.map = map;
+	routing.mappings_alloc = routing.mappings_alloc ? routing.mappings_alloc * 2 : 64;
+
+	//keep the index load factor at or below 1/2
+	routing.map_index_alloc = routing.mappings_alloc * 2;
+	routing.map_index = calloc(routing.map_index_alloc, sizeof(size_t));
+	if(!routing.map_index){
+		LOG("Failed to allocate memory");
+		routing.map_index = old;
+		routing.map_index_alloc = old_alloc;
+		return 1;
+	}
+
+	for(u = 0; u < routing.mappings; u++){
+		for(slot = routing_hash(routing.map[u].from); routing.map_index[slot]; slot = (slot + 1) & (routing.map_index_alloc - 1)){
+		}
+		routing.map_index[slot] = u + 1;
+	}
+
+	free(old);
+	return 0;
 }
 
 int mm_map_channel(channel* from, channel* to){
-	size_t u, m, bucket = routing_hash(from);
+	size_t u, m, slot;
+
+	if(routing.mappings == routing.mappings_alloc && routing_map_grow()){
+		return 1;
+	}
 
 	//find existing source mapping
-	for(u = 0; u < routing.entries[bucket]; u++){
-		if(routing.map[bucket][u].from == from){
+	for(slot = routing_hash(from); routing.map_index[slot]; slot = (slot + 1) & (routing.map_index_alloc - 1)){
+		if(routing.map[routing.map_index[slot] - 1].from == from){
 			break;
 		}
 	}
 
 	//create new entry
-	if(u == routing.entries[bucket]){
-		routing.map[bucket] = realloc(routing.map[bucket], (routing.entries[bucket] + 1) * sizeof(channel_mapping));
-		if(!routing.map[bucket]){
-			routing.entries[bucket] = 0;
+	if(!routing.map_index[slot]){
+		memset(routing.map + routing.mappings, 0, sizeof(channel_mapping));
+		routing.map[routing.mappings].from = from;
+		routing.map_index[slot] = ++routing.mappings;
+	}
+	u = routing.map_index[slot] - 1;
+
+	//check whether the target is already mapped
+	for(m = 0; m < routing.map[u].destinations; m++){
+		if(routing.map[u].to[m] == to){
+			return 0;
+		}
+	}
+
+	//add a mapping target
+	routing.map[u].to = realloc(routing.map[u].to, (routing.map[u].destinations + 1) * sizeof(channel*));
+	if(!routing.map[u].to){
+		LOG("Failed to allocate memory");
+		routing.map[u].destinations = 0;
+		return 1;
+	}
+
+	routing.map[u].to[routing.map[u].destinations] = to;
+	routing.map[u].destinations++;
+	routing.dirty = 1;
+	return 0;
+}
+
+static size_t routing_queue_hash(instance* inst){
+	return routing_mix((uint64_t) inst) & (routing.queue_map_alloc - 1);
+}
+
+static int routing_coalesce(char* instances){
+	char* token = NULL, *names = strdup(instances), *save = NULL;
+	char** name = NULL;
+
+	if(!names){
+		LOG("Failed to allocate memory");
+		return 1;
+	}
+
+	for(token = strtok_r(names, ", \t", &save); token; token = strtok_r(NULL, ", \t", &save)){
+		name = realloc(routing.coalesce_name, (routing.coalesce_names + 1) * sizeof(char*));
+		if(!name){
+			LOG("Failed to allocate memory");
+			free(names);
+			return 1;
+		}
+		routing.coalesce_name = name;
+
+		routing.coalesce_name[routing.coalesce_names] = strdup(token);
+		if(!routing.coalesce_name[routing.coalesce_names]){
 			LOG("Failed to allocate memory");
+			free(names);
+			return 1;
+		}
+		routing.coalesce_names++;
+	}
+
+	free(names);
+	return 0;
+}
+
+int routing_configure(char* option, char* value){
+	if(!strcmp(option, "coalesce")){
+		return routing_coalesce(value);
+	}
+	else if(!strcmp(option, "queue-limit")){
+		routing.queue_limit = strtoul(value, NULL, 10);
+		if(routing.queue_limit < MM_QUEUE_MINIMUM){
+			LOGPF("Queue limit %s too small, must be at least %d", value, MM_QUEUE_MINIMUM);
 			return 1;
 		}
+		return 0;
+	}
+
+	LOGPF("Unknown routing option %s", option);
+	return 1;
+}
 
-		memset(routing.map[bucket] + routing.entries[bucket], 0, sizeof(channel_mapping));
-		routing.entries[bucket]++;
-		routing.map[bucket][u].from = from;
+static int routing_queue_map_grow(){
+	size_t u, slot, old_alloc = routing.queue_map_alloc;
+	queue_slot* old = routing.queue_map;
+
+	routing.queue_map_alloc = old_alloc ? old_alloc * 2 : 64;
+	routing.queue_map = calloc(routing.queue_map_alloc, sizeof(queue_slot));
+	if(!routing.queue_map){
+		LOG("Failed to allocate memory");
+		routing.queue_map = old;
+		routing.queue_map_alloc = old_alloc;
+		return 1;
 	}
 
-	//check whether the target is already mapped
-	for(m = 0; m < routing.map[bucket][u].destinations; m++){
-		if(routing.map[bucket][u].to[m] == to){
+	for(u = 0; u < old_alloc; u++){
+		if(old[u].instance){
+			for(slot = routing_queue_hash(old[u].instance); routing.queue_map[slot].instance; slot = (slot + 1) & (routing.queue_map_alloc - 1)){
+			}
+			routing.queue_map[slot] = old[u];
+		}
+	}
+
+	free(old);
+	return 0;
+}
+
+static int routing_queue_find(instance* inst, size_t* queue){
+	size_t slot;
+
+	if(!routing.queue_map_alloc){
+		return 1;
+	}
+
+	for(slot = routing_queue_hash(inst); routing.queue_map[slot].instance; slot = (slot + 1) & (routing.queue_map_alloc - 1)){
+		if(routing.queue_map[slot].instance == inst){
+			*queue = routing.queue_map[slot].queue;
 			return 0;
 		}
 	}
+	return 1;
+}
 
-	//add a mapping target
-	routing.map[bucket][u].to = realloc(routing.map[bucket][u].to, (routing.map[bucket][u].destinations + 1) * sizeof(channel*));
-	if(!routing.map[bucket][u].to){
+//find or assign the queue index for a target instance, indices stay stable until routing_cleanup
+static int routing_queue_index(instance* inst, size_t* queue){
+	size_t slot, u;
+
+	if((routing.instances + 1) * 2 > routing.queue_map_alloc && routing_queue_map_grow()){
+		return 1;
+	}
+
+	for(slot = routing_queue_hash(inst); routing.queue_map[slot].instance; slot = (slot + 1) & (routing.queue_map_alloc - 1)){
+		if(routing.queue_map[slot].instance == inst){
+			*queue = routing.queue_map[slot].queue;
+			return 0;
+		}
+	}
+
+	routing.instance = realloc(routing.instance, (routing.instances + 1) * sizeof(instance*));
+	routing.coalesce = realloc(routing.coalesce, (routing.instances + 1) * sizeof(uint8_t));
+	routing.limit = realloc(routing.limit, (routing.instances + 1) * sizeof(size_t));
+	routing.drops = realloc(routing.drops, (routing.instances + 1) * sizeof(uint64_t));
+	if(!routing.instance || !routing.coalesce || !routing.limit || !routing.drops){
 		LOG("Failed to allocate memory");
-		routing.map[bucket][u].destinations = 0;
+		routing.instances = 0;
 		return 1;
 	}
 
-	routing.map[bucket][u].to[routing.map[bucket][u].destinations] = to;
-	routing.map[bucket][u].destinations++;
+	routing.instance[routing.instances] = inst;
+	routing.coalesce[routing.instances] = 0;
+	routing.limit[routing.instances] = routing.queue_limit;
+	routing.drops[routing.instances] = 0;
+	for(u = 0; u < routing.coalesce_names; u++){
+		if(!strcmp(routing.coalesce_name[u], inst->name)){
+			DBGPF("Coalescing events for instance %s", inst->name);
+			routing.coalesce[routing.instances] = 1;
+		}
+	}
+
+	routing.queue_map[slot].instance = inst;
+	routing.queue_map[slot].queue = routing.instances;
+	*queue = routing.instances++;
 	return 0;
 }
 
-MM_API int mm_channel_event(channel* c, channel_value v){
-	size_t u, p, bucket = routing_hash(c);
+static int routing_queue_resize(event_queue* queue, size_t alloc){
+	channel** chan = realloc(queue->channel, alloc * sizeof(channel*));
+	channel_value* value = NULL;
 
-	//find mapped channels
-	for(u = 0; u < routing.entries[bucket]; u++){
-		if(routing.map[bucket][u].from == c){
-			break;
+	if(!chan){
+		LOG("Failed to allocate memory");
+		return 1;
+	}
+	queue->channel = chan;
+
+	value = realloc(queue->value, alloc * sizeof(channel_value));
+	if(!value){
+		LOG("Failed to allocate memory");
+		return 1;
+	}
+	queue->value = value;
+	queue->alloc = alloc;
+	return 0;
+}
+
+//extend all event collections to hold one queue per known target instance and preallocate each queue for its in-degree
+static int routing_queues_extend(size_t targets){
+	size_t u, q, reserve;
+	size_t* degree = calloc(routing.instances, sizeof(size_t));
+	event_queue* queue = NULL;
+
+	if(routing.instances && !degree){
+		LOG("Failed to allocate memory");
+		return 1;
+	}
+
+	//one event per incoming mapping covers an iteration in which every source fires once
+	for(u = 0; u < targets; u++){
+		degree[routing.table.queue[u]]++;
+	}
+
+	//a single update of all sources must never be dropped, so the limit covers at least the in-degree
+	for(q = 0; q < routing.instances; q++){
+		routing.limit[q] = max(routing.queue_limit, degree[q]);
+		if(degree[q] > routing.queue_limit){
+			LOGPF("Instance %s has %" PRIsize_t " incoming mappings, raising its queue limit from %" PRIsize_t,
+					routing.instance[q]->name, degree[q], routing.queue_limit);
 		}
 	}
 
-	if(u == routing.entries[bucket]){
-		//target-only channel
+	for(u = 0; u < sizeof(routing.pool) / sizeof(routing.pool[0]); u++){
+		if(routing.pool[u].queues < routing.instances){
+			queue = realloc(routing.pool[u].queue, routing.instances * sizeof(event_queue));
+			if(!queue){
+				LOG("Failed to allocate memory");
+				free(degree);
+				return 1;
+			}
+			memset(queue + routing.pool[u].queues, 0, (routing.instances - routing.pool[u].queues) * sizeof(event_queue));
+			routing.pool[u].queue = queue;
+			routing.pool[u].queues = routing.instances;
+		}
+
+		for(q = 0; q < routing.pool[u].queues; q++){
+			reserve = min(max(degree[q], MM_QUEUE_MINIMUM), routing.limit[q]);
+			if(routing.pool[u].queue[q].alloc < reserve && routing_queue_resize(routing.pool[u].queue + q, reserve)){
+				free(degree);
+				return 1;
+			}
+		}
+	}
+
+	free(degree);
+	return 0;
+}
+
+static void routing_table_free(){
+	//stale route indices in channels are caught by the source check in mm_channel_event
+	free(routing.table.source);
+	routing.table.source = NULL;
+	free(routing.table.offset);
+	routing.table.offset = NULL;
+	free(routing.table.target);
+	routing.table.target = NULL;
+	free(routing.table.queue);
+	routing.table.queue = NULL;
+	free(routing.table.slot);
+	routing.table.slot = NULL;
+	free(routing.table.slot_position);
+	routing.table.slot_position = NULL;
+	free(routing.table.slot_generation);
+	routing.table.slot_generation = NULL;
+	routing.table.slots = 0;
+	free(routing.table.rank);
+	routing.table.rank = NULL;
+	free(routing.table.order);
+	routing.table.order = NULL;
+	routing.table.loops = 0;
+	routing.table.sources = 0;
+}
+
+//assign one coalescing slot to each distinct target channel on a coalescing instance
+static int routing_compile_coalescing(size_t targets){
+	size_t u, slot, alloc = 4, coalescing = 0;
+	channel** map = NULL;
+	size_t* id = NULL;
+
+	routing.table.slot = calloc(targets, sizeof(size_t));
+	if(targets && !routing.table.slot){
+		LOG("Failed to allocate memory");
+		return 1;
+	}
+
+	for(u = 0; u < targets; u++){
+		routing.table.slot[u] = MM_NO_COALESCE;
+		coalescing += routing.coalesce[routing.table.queue[u]];
+	}
+
+	if(!coalescing){
+		return 0;
+	}
+
+	for(; alloc < 2 * coalescing; alloc *= 2){
+	}
+
+	map = calloc(alloc, sizeof(channel*));
+	id = calloc(alloc, sizeof(size_t));
+	if(!map || !id){
+		LOG("Failed to allocate memory");
+		free(map);
+		free(id);
+		return 1;
+	}
+
+	for(u = 0; u < targets; u++){
+		if(routing.coalesce[routing.table.queue[u]]){
+			for(slot = routing_mix((uint64_t) routing.table.target[u]) & (alloc - 1);
+					map[slot] && map[slot] != routing.table.target[u];
+					slot = (slot + 1) & (alloc - 1)){
+			}
+
+			if(!map[slot]){
+				map[slot] = routing.table.target[u];
+				id[slot] = routing.table.slots++;
+			}
+			routing.table.slot[u] = id[slot];
+		}
+	}
+
+	free(map);
+	free(id);
+
+	routing.table.slot_position = calloc(routing.table.slots, sizeof(size_t));
+	routing.table.slot_generation = calloc(routing.table.slots, sizeof(uint64_t));
+	if(!routing.table.slot_position || !routing.table.slot_generation){
+		LOG("Failed to allocate memory");
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Iterative variant of Tarjan's algorithm over a graph in compressed sparse row form.
+ * Component identifiers are assigned in reverse topological order, ie. component 0 has no
+ * edges into other components. Returns the number of components, 0 on failure.
+ */
+static size_t routing_scc(size_t nodes, size_t* offset, size_t* edge, size_t* component){
+	size_t u, v, w, depth = 0, stacked = 0, visits = 0, components = 0;
+	size_t* index = calloc(nodes, sizeof(size_t));
+	size_t* low = calloc(nodes, sizeof(size_t));
+	size_t* next = calloc(nodes, sizeof(size_t));
+	size_t* stack = calloc(nodes, sizeof(size_t));
+	size_t* call = calloc(nodes, sizeof(size_t));
+	uint8_t* on_stack = calloc(nodes, sizeof(uint8_t));
+
+	if(!index || !low || !next || !stack || !call || !on_stack){
+		LOG("Failed to allocate memory");
+		goto bail;
+	}
+
+	for(u = 0; u < nodes; u++){
+		if(index[u]){
+			continue;
+		}
+
+		index[u] = low[u] = ++visits;
+		next[u] = offset[u];
+		stack[stacked++] = u;
+		on_stack[u] = 1;
+		call[depth++] = u;
+
+		while(depth){
+			v = call[depth - 1];
+			if(next[v] < offset[v + 1]){
+				w = edge[next[v]++];
+				if(!index[w]){
+					index[w] = low[w] = ++visits;
+					next[w] = offset[w];
+					stack[stacked++] = w;
+					on_stack[w] = 1;
+					call[depth++] = w;
+				}
+				else if(on_stack[w]){
+					low[v] = min(low[v], index[w]);
+				}
+				continue;
+			}
+
+			depth--;
+			if(depth){
+				low[call[depth - 1]] = min(low[call[depth - 1]], low[v]);
+			}
+
+			//v is the root of a component, pop it from the stack
+			if(low[v] == index[v]){
+				do{
+					w = stack[--stacked];
+					on_stack[w] = 0;
+					component[w] = components;
+				} while(w != v);
+				components++;
+			}
+		}
+	}
+
+bail:
+	free(index);
+	free(low);
+	free(next);
+	free(stack);
+	free(call);
+	free(on_stack);
+	return components;
+}
+
+//log one cyclic component of the channel graph by walking its edges from the first member
+static void routing_report_loop(char* kind, size_t member, size_t members, size_t* offset, size_t* edge, size_t* component){
+	char path[512] = "";
+	size_t u, current = member, steps = 0, length = 0;
+
+	do{
+		length += snprintf(path + length, sizeof(path) - length, "%s%s:%" PRIu64,
+				steps ? " > " : "", routing.table.source[current]->instance->name, routing.table.source[current]->ident);
+		length = min(length, sizeof(path) - 1);
+
+		//follow the first edge that stays within the component
+		for(u = offset[current]; u < offset[current + 1]; u++){
+			if(component[edge[u]] == component[member]){
+				break;
+			}
+		}
+		current = edge[u];
+		steps++;
+	} while(current != member && steps < min(members, MM_LOOP_PATH_LIMIT));
+
+	LOGPF("%s through %" PRIsize_t " channels: %s > %s%s:%" PRIu64, kind, members, path,
+			(current == member) ? "" : "... > ",
+			routing.table.source[current]->instance->name, routing.table.source[current]->ident);
+}
+
+//check whether a mapping edge (source index, target position) is part of a suppressed bidirectional pair
+static int routing_pair_edge(size_t source, size_t position, size_t* component, uint8_t* pair){
+	channel* target = routing.table.target[position];
+
+	if(!pair || !target->route || target->route > routing.table.sources || routing.table.source[target->route - 1] != target){
 		return 0;
 	}
+	return component[target->route - 1] == component[source] && pair[component[source]];
+}
+
+/*
+ * Analyse the compiled mapping graph. On the channel level, a channel that is a mapping target
+ * and a source may pass events on (eg. loopback), which is used to detect mapping loops.
+ * On the instance level, the condensation of the graph yields the dispatch order, so events
+ * generated while handling output for one instance can be delivered to later instances
+ * within the same collector swap.
+ */
+static int routing_analyse(size_t targets){
+	size_t u, p, edges = 0, components, source_queue;
+	size_t* offset = calloc(max(routing.table.sources, routing.instances) + 1, sizeof(size_t));
+	size_t* edge = calloc(max(targets, 1), sizeof(size_t));
+	size_t* component = calloc(routing.table.sources + 1, sizeof(size_t));
+	size_t* instance_component = calloc(routing.instances + 1, sizeof(size_t));
+	size_t* members = NULL;
+	uint8_t* self = NULL, *pair = NULL;
+	char* kind = NULL;
+	int rv = 1;
+
+	routing.table.rank = calloc(routing.instances + 1, sizeof(size_t));
+	routing.table.order = calloc(routing.instances + 1, sizeof(size_t));
+	if(!offset || !edge || !component || !instance_component || !routing.table.rank || !routing.table.order){
+		LOG("Failed to allocate memory");
+		goto bail;
+	}
 
-	//resize event structures to fit additional events
-	if(routing.events->n + routing.map[bucket][u].destinations >= routing.events->alloc){
-		routing.events->channel = realloc(routing.events->channel, (routing.events->alloc + routing.map[bucket][u].destinations) * sizeof(channel*));
-		routing.events->value = realloc(routing.events->value, (routing.events->alloc + routing.map[bucket][u].destinations) * sizeof(channel_value));
+	//channel graph, only edges to targets which are sources themselves
+	for(u = 0; u < routing.table.sources; u++){
+		offset[u] = edges;
+		for(p = routing.table.offset[u]; p < routing.table.offset[u + 1]; p++){
+			if(routing.table.target[p]->route
+					&& routing.table.target[p]->route <= routing.table.sources
+					&& routing.table.source[routing.table.target[p]->route - 1] == routing.table.target[p]){
+				edge[edges++] = routing.table.target[p]->route - 1;
+			}
+		}
+	}
+	offset[routing.table.sources] = edges;
 
-		if(!routing.events->channel || !routing.events->value){
+	if(edges){
+		components = routing_scc(routing.table.sources, offset, edge, component);
+		members = calloc(components, sizeof(size_t));
+		self = calloc(components, sizeof(uint8_t));
+		pair = calloc(components, sizeof(uint8_t));
+		if(!components || !members || !self || !pair){
 			LOG("Failed to allocate memory");
-			routing.events->alloc = 0;
-			routing.events->n = 0;
+			goto bail;
+		}
+
+		for(u = 0; u < routing.table.sources; u++){
+			members[component[u]]++;
+			for(p = offset[u]; p < offset[u + 1]; p++){
+				self[component[u]] |= (edge[p] == u);
+			}
+		}
+
+		for(u = 0; u < routing.table.sources; u++){
+			if(members[component[u]] > 1 || self[component[u]]){
+				kind = "Mapping loop";
+				//bidirectional mappings between two instances are common and only loop if both backends echo output
+				if(members[component[u]] == 2 && !self[component[u]]){
+					for(p = offset[u]; component[edge[p]] != component[u]; p++){
+					}
+
+					if(routing.table.source[u]->instance != routing.table.source[edge[p]]->instance){
+						pair[component[u]] = 1;
+						if((routing.table.source[u]->instance->backend->flags & mmbackend_no_echo)
+								|| (routing.table.source[edge[p]]->instance->backend->flags & mmbackend_no_echo)){
+							members[component[u]] = 0;
+							continue;
+						}
+						kind = "Possible mapping loop (if both backends echo output)";
+					}
+				}
+
+				if(routing.table.loops < MM_LOOP_REPORT_LIMIT){
+					routing_report_loop(kind, u, members[component[u]], offset, edge, component);
+				}
+				routing.table.loops++;
+				//report every component only once
+				members[component[u]] = 0;
+				self[component[u]] = 0;
+			}
+		}
+
+		if(routing.table.loops > MM_LOOP_REPORT_LIMIT){
+			LOGPF("%" PRIsize_t " further mapping loops not shown", routing.table.loops - MM_LOOP_REPORT_LIMIT);
+		}
+	}
+
+	//instance graph, edges from the queue of each source instance to its target queues
+	//bidirectional pairs are left out, as they would otherwise merge most instances into one component
+	memset(offset, 0, (routing.instances + 1) * sizeof(size_t));
+	for(u = 0; u < routing.table.sources; u++){
+		if(!routing_queue_find(routing.table.source[u]->instance, &source_queue)){
+			for(p = routing.table.offset[u]; p < routing.table.offset[u + 1]; p++){
+				offset[source_queue + 1] += !routing_pair_edge(u, p, component, pair);
+			}
+		}
+	}
+	for(u = 0; u < routing.instances; u++){
+		offset[u + 1] += offset[u];
+	}
+	//use the rank array as fill cursor
+	memcpy(routing.table.rank, offset, routing.instances * sizeof(size_t));
+	for(u = 0; u < routing.table.sources; u++){
+		if(!routing_queue_find(routing.table.source[u]->instance, &source_queue)){
+			for(p = routing.table.offset[u]; p < routing.table.offset[u + 1]; p++){
+				if(!routing_pair_edge(u, p, component, pair)){
+					edge[routing.table.rank[source_queue]++] = routing.table.queue[p];
+				}
+			}
+		}
+	}
+
+	components = routing.instances ? routing_scc(routing.instances, offset, edge, instance_component) : 0;
+	if(routing.instances && !components){
+		goto bail;
+	}
+
+	//reverse the component order to get topological ranks, then sort the queues by rank
+	memset(offset, 0, (components + 1) * sizeof(size_t));
+	for(u = 0; u < routing.instances; u++){
+		routing.table.rank[u] = components - 1 - instance_component[u];
+		offset[routing.table.rank[u] + 1]++;
+	}
+	for(u = 0; u < components; u++){
+		offset[u + 1] += offset[u];
+	}
+	for(u = 0; u < routing.instances; u++){
+		routing.table.order[offset[routing.table.rank[u]]++] = u;
+	}
+
+	rv = 0;
+bail:
+	free(offset);
+	free(edge);
+	free(component);
+	free(instance_component);
+	free(members);
+	free(self);
+	free(pair);
+	return rv;
+}
+
+int routing_compile(){
+	size_t u, sources = 0, targets = 0;
+	clock_t start = clock();
+
+	routing_table_free();
+
+	sources = routing.mappings;
+	for(u = 0; u < routing.mappings; u++){
+		targets += routing.map[u].destinations;
+	}
+
+	routing.table.source = calloc(sources, sizeof(channel*));
+	routing.table.offset = calloc(sources + 1, sizeof(size_t));
+	routing.table.target = calloc(targets, sizeof(channel*));
+	routing.table.queue = calloc(targets, sizeof(size_t));
+	if((sources && !routing.table.source) || !routing.table.offset || (targets && (!routing.table.target || !routing.table.queue))){
+		LOG("Failed to allocate memory");
+		routing_table_free();
+		return 1;
+	}
+
+	//assign dense source indices and copy the target lists back to back
+	for(u = 0; u < routing.mappings; u++){
+		routing.table.source[routing.table.sources] = routing.map[u].from;
+		memcpy(routing.table.target + routing.table.offset[routing.table.sources], routing.map[u].to, routing.map[u].destinations * sizeof(channel*));
+		routing.table.offset[routing.table.sources + 1] = routing.table.offset[routing.table.sources] + routing.map[u].destinations;
+		routing.table.sources++;
+		routing.map[u].from->route = routing.table.sources;
+	}
+
+	//resolve the target queues
+	for(u = 0; u < targets; u++){
+		if(routing_queue_index(routing.table.target[u]->instance, routing.table.queue + u)){
+			routing_table_free();
 			return 1;
 		}
+	}
+
+	if(routing_queues_extend(targets) || routing_compile_coalescing(targets) || routing_analyse(targets)){
+		routing_table_free();
+		return 1;
+	}
+
+	//invalidate coalescing positions recorded against the previous table
+	routing.events->generation = ++routing.generation;
+
+	routing.dirty = 0;
+	routing.table.build_usec = ((uint64_t) (clock() - start)) * 1000000 / CLOCKS_PER_SEC;
+	DBGPF("Compiled routing table with %" PRIsize_t " sources and %" PRIsize_t " targets", sources, targets);
+	return 0;
+}
+
+MM_API int mm_channel_event(channel* c, channel_value v){
+	size_t p, destinations, offset, slot;
+	event_collection* collection = NULL;
+	event_queue* queue = NULL;
+
+	//events generated on worker threads are routed by the main thread
+	if(thread_worker()){
+		return thread_emit(c, v);
+	}
 
-		routing.events->alloc += routing.map[bucket][u].destinations;
+	//mappings were added since the last compilation
+	if(routing.dirty && routing_compile()){
+		return 1;
 	}
 
-	//enqueue channel events
+	STATS_ADD(instance_stats(c->instance)->events_in, 1);
+
+	//backends managing their own channels may not have zeroed the route index, so verify it
+	if(!c->route || c->route > routing.table.sources || routing.table.source[c->route - 1] != c){
+		//target-only channel
+		return 0;
+	}
+
+	offset = routing.table.offset[c->route - 1];
+	destinations = routing.table.offset[c->route] - offset;
+
+	//events not stamped at their origin are tagged with the time of the iteration they were collected in
+	if(!v.timestamp){
+		v.timestamp = mm_timestamp_ns();
+	}
+
+	//enqueue channel events to the target instance queues
 	/*
 	 * This might lead to one channel being mentioned multiple times in an apply call.
-	 * That effect should not be eliminated as there are legitimate uses for one channel
-	 * being set multiple times in one core iteration (e.g. for stateful layer selection messages)
+	 * That effect should not be eliminated by default as there are legitimate uses for one channel
+	 * being set multiple times in one core iteration (e.g. for stateful layer selection messages).
+	 * Instances configured for coalescing only receive the latest value per channel.
 	 */
-	memcpy(routing.events->channel + routing.events->n, routing.map[bucket][u].to, routing.map[bucket][u].destinations * sizeof(channel*));
-	for(p = 0; p < routing.map[bucket][u].destinations; p++){
-		routing.events->value[routing.events->n + p] = v;
-	}
+	for(p = 0; p < destinations; p++){
+		//events for instances that have not been handled yet in the current dispatch round are delivered in the same round
+		collection = routing.events;
+		if(routing.dispatching && routing.table.rank[routing.table.queue[offset + p]] > routing.dispatch_rank){
+			collection = routing.dispatching;
+		}
+
+		queue = collection->queue + routing.table.queue[offset + p];
+		slot = routing.table.slot[offset + p];
+
+		if(slot != MM_NO_COALESCE && routing.table.slot_generation[slot] == collection->generation){
+			queue->value[routing.table.slot_position[slot]] = v;
+			STATS_ADD(routing.coalesced, 1);
+			continue;
+		}
+
+		//bounded growth, excess events are dropped to apply back-pressure on runaway mappings
+		if(queue->n == queue->alloc){
+			if(queue->alloc >= routing.limit[routing.table.queue[offset + p]]){
+				//report the first drop for every instance
+				if(!routing.drops[routing.table.queue[offset + p]]){
+					LOGPF("Event queue for instance %s exceeded the limit of %" PRIsize_t " events, dropping events",
+							routing.instance[routing.table.queue[offset + p]]->name, routing.limit[routing.table.queue[offset + p]]);
+				}
+				routing.drops[routing.table.queue[offset + p]]++;
+				STATS_ADD(routing.dropped, 1);
+				continue;
+			}
+
+			if(routing_queue_resize(queue, min(queue->alloc * 2, routing.limit[routing.table.queue[offset + p]]))){
+				return 1;
+			}
+		}
 
-	routing.events->n += routing.map[bucket][u].destinations;
+		if(slot != MM_NO_COALESCE){
+			routing.table.slot_generation[slot] = collection->generation;
+			routing.table.slot_position[slot] = queue->n;
+		}
+
+		queue->channel[queue->n] = routing.table.target[offset + p];
+		queue->value[queue->n] = v;
+		queue->n++;
+		collection->n++;
+		routing.high_water = max(routing.high_water, queue->n);
+		STATS_ADD(routing.routed, 1);
+	}
 	return 0;
 }
 
+void routing_counters(mm_core_stats* stats){
+	stats->routed = __atomic_load_n(&routing.routed, __ATOMIC_RELAXED);
+	stats->swaps = __atomic_load_n(&routing.swaps, __ATOMIC_RELAXED);
+	stats->coalesced = __atomic_load_n(&routing.coalesced, __ATOMIC_RELAXED);
+	stats->dropped = __atomic_load_n(&routing.dropped, __ATOMIC_RELAXED);
+}
+
 void routing_stats(){
-	size_t n = 0, u, max = 0;
+	size_t n = 0, u;
 
-	//count and report mappings
-	for(u = 0; u < sizeof(routing.map) / sizeof(routing.map[0]); u++){
-		n += routing.entries[u];
-		max = max(max, routing.entries[u]);
+	LOGPF("Routing %" PRIsize_t " sources", routing.mappings);
+
+	if(!routing.dirty && routing.table.offset){
+		LOGPF("Compiled routing table: %" PRIsize_t " sources, %" PRIsize_t " targets, %" PRIsize_t " bytes, built in %" PRIu64 " usec",
+				routing.table.sources, routing.table.offset[routing.table.sources],
+				routing.table.sources * sizeof(channel*) + (routing.table.sources + 1) * sizeof(size_t)
+					+ routing.table.offset[routing.table.sources] * (sizeof(channel*) + 2 * sizeof(size_t))
+					+ routing.table.slots * (sizeof(size_t) + sizeof(uint64_t)),
+				routing.table.build_usec);
 	}
 
-	LOGPF("Routing %" PRIsize_t " sources, largest bucket has %" PRIsize_t " entries",
-			n, max);
+	for(u = 0, n = 0; u < routing.pool[0].queues; u++){
+		n += routing.pool[0].queue[u].alloc;
+	}
+	LOGPF("Preallocated %" PRIsize_t " event slots for %" PRIsize_t " target instances, limit %" PRIsize_t " per instance",
+			n, routing.instances, routing.queue_limit);
 }
 
 int routing_iteration(){
 	event_collection* secondary = NULL;
-	size_t u, swaps = 0;
+	size_t u, r, swaps = 0;
+
+	//route events injected from other threads along with the ones collected in this iteration
+	thread_async_collect();
 
 	//limit number of collector swaps per iteration to prevent complete deadlock
 	while(routing.events->n && swaps < MM_SWAP_LIMIT){
@@ -161,42 +931,103 @@ int routing_iteration(){
 			if(routing.events != routing.pool + u){
 				secondary = routing.events;
 				routing.events = routing.pool + u;
+				routing.events->generation = ++routing.generation;
 				break;
 			}
 		}
 
-		//push collected events to target backends
-		if(secondary->n && backends_notify(secondary->n, secondary->channel, secondary->value)){
-			LOG("Backends failed to handle output");
-			return 1;
+		//push collected events to target instances in topological order
+		routing.dispatching = secondary;
+		for(r = 0; r < secondary->queues && r < routing.instances; r++){
+			u = routing.table.order[r];
+			if(secondary->queue[u].n){
+				routing.dispatch_rank = routing.table.rank[u];
+				if(backends_notify(routing.instance[u], secondary->queue[u].n, secondary->queue[u].channel, secondary->queue[u].value)){
+					LOGPF("Instance %s failed to handle output", routing.instance[u]->name);
+				}
+				secondary->queue[u].n = 0;
+			}
 		}
+		routing.dispatching = NULL;
 
 		//reset the event count
 		secondary->n = 0;
+		swaps++;
+		STATS_ADD(routing.swaps, 1);
 	}
 
-	if(swaps == MM_SWAP_LIMIT){
-		LOG("Iteration swap limit hit, a backend may be configured to route events in an infinite loop");
+	if(swaps == MM_SWAP_LIMIT && routing.events->n){
+		LOGPF("Iteration swap limit hit, a backend may be configured to route events in an infinite loop%s",
+				routing.table.loops ? " (see the mapping loops reported on startup)" : "");
 	}
 
 	return 0;
 }
 
+void routing_report(){
+	size_t u;
+
+	if(routing.coalesced){
+		LOGPF("Coalesced %" PRIu64 " events", routing.coalesced);
+	}
+	if(routing.dropped){
+		LOGPF("Dropped %" PRIu64 " events at the queue limit", routing.dropped);
+		for(u = 0; u < routing.instances; u++){
+			if(routing.drops[u]){
+				LOGPF("Dropped %" PRIu64 " events for instance %s", routing.drops[u], routing.instance[u]->name);
+			}
+		}
+	}
+}
+
 void routing_cleanup(){
 	size_t u, n;
 
-	for(u = 0; u < sizeof(routing.map) / sizeof(routing.map[0]); u++){
-		for(n = 0; n < routing.entries[u]; n++){
-			free(routing.map[u][n].to);
-		}
-		free(routing.map[u]);
-		routing.map[u] = NULL;
-		routing.entries[u] = 0;
+	routing_table_free();
+	routing.dirty = 0;
+
+	for(u = 0; u < routing.mappings; u++){
+		free(routing.map[u].to);
 	}
+	free(routing.map);
+	free(routing.map_index);
+	routing.map = NULL;
+	routing.map_index = NULL;
+	routing.mappings = routing.mappings_alloc = routing.map_index_alloc = 0;
 
 	for(u = 0; u < sizeof(routing.pool) / sizeof(routing.pool[0]); u++){
-		free(routing.pool[u].channel);
-		free(routing.pool[u].value);
-		routing.pool[u].alloc = 0;
+		for(n = 0; n < routing.pool[u].queues; n++){
+			free(routing.pool[u].queue[n].channel);
+			free(routing.pool[u].queue[n].value);
+		}
+		free(routing.pool[u].queue);
+		routing.pool[u].queue = NULL;
+		routing.pool[u].queues = 0;
+		routing.pool[u].n = 0;
 	}
+
+	DBGPF("Event queue high-water mark was %" PRIsize_t " events", routing.high_water);
+	routing.coalesced = routing.dropped = 0;
+	routing.routed = routing.swaps = 0;
+	routing.high_water = 0;
+
+	for(u = 0; u < routing.coalesce_names; u++){
+		free(routing.coalesce_name[u]);
+	}
+	free(routing.coalesce_name);
+	routing.coalesce_name = NULL;
+	routing.coalesce_names = 0;
+
+	free(routing.instance);
+	routing.instance = NULL;
+	free(routing.coalesce);
+	routing.coalesce = NULL;
+	free(routing.limit);
+	routing.limit = NULL;
+	free(routing.drops);
+	routing.drops = NULL;
+	routing.instances = 0;
+	free(routing.queue_map);
+	routing.queue_map = NULL;
+	routing.queue_map_alloc = 0;
 }
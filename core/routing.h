@@ -1,7 +1,12 @@
 /* Internal API */
 int mm_map_channel(channel* from, channel* to);
+int routing_compile();
+int routing_configure(char* option, char* value);
 int routing_iteration();
 void routing_stats();
+void routing_counters(mm_core_stats* stats);
+//report coalescing and drop counters, called while the target instances are still valid
+void routing_report();
 void routing_cleanup();
 
 /* Public backend API */
@@ -0,0 +1,201 @@
+#include <string.h>
+#ifndef _WIN32
+	#define MM_API __attribute__((visibility ("default")))
+#else
+	#define MM_API __attribute__((dllexport))
+#endif
+
+#define BACKEND_NAME "core/st"
+#include "midimonster.h"
+#include "core.h"
+#include "backend.h"
+#include "routing.h"
+#include "stats.h"
+
+static struct {
+	//interval between periodic dumps in milliseconds, 0 to disable
+	uint64_t interval;
+	uint64_t next;
+
+	uint64_t iterations;
+	uint64_t iteration_ns;
+	uint64_t iteration_max_ns;
+	uint64_t histogram[MM_STATS_BUCKETS];
+} stats = {
+	0
+};
+
+int stats_configure(char* option, char* value){
+	if(!strcmp(option, "stats-interval")){
+		stats.interval = strtoul(value, NULL, 10) * 1000;
+		stats.next = 0;
+		return 0;
+	}
+
+	LOGPF("Unknown statistics option %s", option);
+	return 1;
+}
+
+void stats_call(mm_stats* counters, uint64_t start){
+	uint64_t duration = core_clock() - start;
+
+	STATS_ADD(counters->calls, 1);
+	STATS_ADD(counters->call_ns, duration);
+	if(duration > counters->call_max_ns){
+		__atomic_store_n(&counters->call_max_ns, duration, __ATOMIC_RELAXED);
+	}
+}
+
+void stats_iteration(uint64_t start){
+	uint64_t now = core_clock(), duration = now - start, usec = duration / 1000;
+	size_t bucket = 0;
+
+	for(usec >>= 1; usec && bucket < MM_STATS_BUCKETS - 1; usec >>= 1){
+		bucket++;
+	}
+
+	STATS_ADD(stats.iterations, 1);
+	STATS_ADD(stats.iteration_ns, duration);
+	STATS_ADD(stats.histogram[bucket], 1);
+	if(duration > stats.iteration_max_ns){
+		__atomic_store_n(&stats.iteration_max_ns, duration, __ATOMIC_RELAXED);
+	}
+
+	if(stats.interval){
+		if(!stats.next){
+			stats.next = now / 1000000 + stats.interval;
+		}
+		else if(now / 1000000 >= stats.next){
+			stats_dump();
+			stats.next += stats.interval;
+			//do not try to catch up on missed dumps
+			if(stats.next <= now / 1000000){
+				stats.next = now / 1000000 + stats.interval;
+			}
+		}
+	}
+}
+
+static void stats_load(mm_stats* out, mm_stats* counters){
+	out->events_in = __atomic_load_n(&counters->events_in, __ATOMIC_RELAXED);
+	out->events_out = __atomic_load_n(&counters->events_out, __ATOMIC_RELAXED);
+	out->calls = __atomic_load_n(&counters->calls, __ATOMIC_RELAXED);
+	out->call_ns = __atomic_load_n(&counters->call_ns, __ATOMIC_RELAXED);
+	out->call_max_ns = __atomic_load_n(&counters->call_max_ns, __ATOMIC_RELAXED);
+}
+
+MM_API int mm_stats_instance(char* name, mm_stats* out){
+	instance* inst = instance_match(name);
+
+	if(!inst || !out){
+		return 1;
+	}
+
+	stats_load(out, instance_stats(inst));
+	return 0;
+}
+
+MM_API int mm_stats_backend(char* name, mm_stats* out){
+	backend* b = backend_match(name);
+	instance** inst = NULL;
+	mm_stats current;
+	size_t n, u;
+
+	if(!b || !out || mm_backend_instances(name, &n, &inst)){
+		return 1;
+	}
+
+	stats_load(out, backend_stats(b));
+	out->events_in = out->events_out = 0;
+	for(u = 0; u < n; u++){
+		stats_load(&current, instance_stats(inst[u]));
+		out->events_in += current.events_in;
+		out->events_out += current.events_out;
+	}
+	free(inst);
+	return 0;
+}
+
+MM_API void mm_stats_core(mm_core_stats* out){
+	size_t u;
+
+	if(!out){
+		return;
+	}
+
+	routing_counters(out);
+	out->iterations = __atomic_load_n(&stats.iterations, __ATOMIC_RELAXED);
+	out->iteration_ns = __atomic_load_n(&stats.iteration_ns, __ATOMIC_RELAXED);
+	out->iteration_max_ns = __atomic_load_n(&stats.iteration_max_ns, __ATOMIC_RELAXED);
+	for(u = 0; u < MM_STATS_BUCKETS; u++){
+		out->iteration_histogram[u] = __atomic_load_n(&stats.histogram[u], __ATOMIC_RELAXED);
+	}
+}
+
+static uint64_t stats_percentile(mm_core_stats* core, uint64_t permille){
+	uint64_t count = 0;
+	size_t u;
+
+	//the upper bound of the bucket containing the requested sample
+	for(u = 0; u < MM_STATS_BUCKETS; u++){
+		count += core->iteration_histogram[u];
+		if(count * 1000 >= core->iterations * permille){
+			break;
+		}
+	}
+	return ((uint64_t) 2) << u;
+}
+
+void stats_dump(){
+	mm_core_stats core;
+	mm_stats current;
+	backend* b = NULL;
+	instance** inst = NULL;
+	size_t u, p, n;
+
+	mm_stats_core(&core);
+	if(!core.iterations){
+		return;
+	}
+
+	LOGPF("Core: %" PRIu64 " iterations, average %" PRIu64 " usec, p50 < %" PRIu64 " usec, p99 < %" PRIu64 " usec, maximum %" PRIu64 " usec",
+			core.iterations, core.iteration_ns / core.iterations / 1000,
+			stats_percentile(&core, 500), stats_percentile(&core, 990),
+			core.iteration_max_ns / 1000);
+	LOGPF("Core: %" PRIu64 " events routed, %" PRIu64 " collector swaps, %" PRIu64 " coalesced, %" PRIu64 " dropped",
+			core.routed, core.swaps, core.coalesced, core.dropped);
+
+	for(u = 0; (b = backend_get(u)); u++){
+		if(mm_backend_instances(b->name, &n, &inst) || !n){
+			continue;
+		}
+
+		if(!mm_stats_backend(b->name, &current)){
+			LOGPF("Backend %s: %" PRIu64 " events in, %" PRIu64 " out, %" PRIu64 " process calls, average %" PRIu64 " usec, maximum %" PRIu64 " usec",
+					b->name, current.events_in, current.events_out, current.calls,
+					current.calls ? current.call_ns / current.calls / 1000 : 0,
+					current.call_max_ns / 1000);
+		}
+
+		for(p = 0; p < n; p++){
+			stats_load(&current, instance_stats(inst[p]));
+			LOGPF("Instance %s: %" PRIu64 " events in, %" PRIu64 " out, %" PRIu64 " handle calls, average %" PRIu64 " usec, maximum %" PRIu64 " usec",
+					inst[p]->name, current.events_in, current.events_out, current.calls,
+					current.calls ? current.call_ns / current.calls / 1000 : 0,
+					current.call_max_ns / 1000);
+		}
+		free(inst);
+		inst = NULL;
+	}
+}
+
+void stats_cleanup(){
+	//report the final values if periodic reports were requested
+	if(stats.interval){
+		stats_dump();
+	}
+
+	stats.iterations = stats.iteration_ns = stats.iteration_max_ns = 0;
+	memset(stats.histogram, 0, sizeof(stats.histogram));
+	stats.next = 0;
+}
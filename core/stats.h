@@ -0,0 +1,17 @@
+/*
+ * Every counter is only written by one thread, so a relaxed store suffices
+ * to make the values readable from other threads without tearing.
+ */
+#define STATS_ADD(counter, value) __atomic_store_n(&(counter), (counter) + (value), __ATOMIC_RELAXED)
+
+/* Internal API */
+int stats_configure(char* option, char* value);
+void stats_call(mm_stats* stats, uint64_t start);
+void stats_iteration(uint64_t start);
+void stats_dump();
+void stats_cleanup();
+
+/* Public backend API */
+MM_API int mm_stats_instance(char* name, mm_stats* stats);
+MM_API int mm_stats_backend(char* name, mm_stats* stats);
+MM_API void mm_stats_core(mm_core_stats* stats);
@@ -0,0 +1,985 @@
+#ifdef __linux__
+	//required for the CPU affinity interfaces
+	#define _GNU_SOURCE
+#endif
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#ifndef _WIN32
+	#include <pthread.h>
+	#include <sched.h>
+	#include <poll.h>
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#ifdef __linux__
+		#include <sys/eventfd.h>
+		#define MM_AFFINITY
+	#endif
+	#define MM_API __attribute__((visibility ("default")))
+#else
+	#define MM_API __attribute__((dllexport))
+#endif
+
+#define BACKEND_NAME "core/th"
+#define MM_THREAD_RING 16384
+#define MM_THREAD_INTERVAL 1000
+#include "midimonster.h"
+#include "core.h"
+#include "backend.h"
+#include "routing.h"
+#include "timer.h"
+#include "thread.h"
+
+//lock-free multi-producer single-consumer ring for events injected via mm_channel_event_async
+typedef struct /*_mm_thread_async_event*/ {
+	size_t sequence;
+	channel* channel;
+	channel_value value;
+} thread_async_event;
+
+static struct {
+	//claimed by the producers
+	size_t head;
+	//only written by the consumer
+	size_t tail;
+	size_t dropped;
+	uint8_t pending;
+	thread_async_event* event;
+} async = {
+	0
+};
+
+static int thread_async_prepare();
+static void thread_async_cleanup();
+static void thread_async_wake();
+
+#ifndef _WIN32
+/* Core-internal structures */
+typedef struct /*_mm_thread_event*/ {
+	instance* instance;
+	channel* channel;
+	channel_value value;
+} thread_event;
+
+//lock-free single-producer single-consumer event ring
+typedef struct /*_mm_thread_ring*/ {
+	//only written by the producer
+	size_t head;
+	size_t dropped;
+	//only written by the consumer
+	size_t tail;
+	thread_event event[MM_THREAD_RING];
+} thread_ring;
+
+typedef struct /*_mm_worker*/ {
+	backend* backend;
+	size_t context;
+	pthread_t thread;
+	uint8_t running;
+	uint8_t shutdown;
+	uint8_t failed;
+	uint8_t emitted;
+	int wake[2];
+
+	//events to be handled by the backend, produced by the main thread
+	thread_ring inbound;
+	//events generated by the backend, consumed by the main thread
+	thread_ring outbound;
+
+	//descriptors managed by the backend, poll[0] is the wake-up pipe
+	size_t nfds;
+	managed_fd* fd;
+	managed_fd* signaled;
+	struct pollfd* poll;
+
+	//batch buffers for calling the handle callback
+	channel** channel;
+	channel_value* value;
+} mm_worker;
+
+static struct {
+	size_t names;
+	char** name;
+
+	size_t n;
+	mm_worker** worker;
+	int wake[2];
+	uint8_t locking;
+	pthread_mutex_t lock;
+
+	//scheduling parameters for the main loop and the worker threads
+	uint8_t realtime;
+	int policy;
+	int priority;
+	uint8_t memory_lock;
+	#ifdef MM_AFFINITY
+	uint8_t affinity_set;
+	cpu_set_t affinity;
+	uint8_t thread_affinity_set;
+	cpu_set_t thread_affinity;
+	#endif
+} threads = {
+	.wake = {-1, -1},
+	.policy = SCHED_OTHER
+};
+
+//the worker executing the current thread, NULL on the main thread
+static __thread mm_worker* thread_self = NULL;
+
+static int thread_option(char* names){
+	char* token = NULL, *list = strdup(names), *save = NULL;
+	char** name = NULL;
+
+	if(!list){
+		LOG("Failed to allocate memory");
+		return 1;
+	}
+
+	for(token = strtok_r(list, ", \t", &save); token; token = strtok_r(NULL, ", \t", &save)){
+		name = realloc(threads.name, (threads.names + 1) * sizeof(char*));
+		if(!name){
+			LOG("Failed to allocate memory");
+			free(list);
+			return 1;
+		}
+		threads.name = name;
+
+		threads.name[threads.names] = strdup(token);
+		if(!threads.name[threads.names]){
+			LOG("Failed to allocate memory");
+			free(list);
+			return 1;
+		}
+		threads.names++;
+	}
+
+	free(list);
+	return 0;
+}
+
+#ifdef MM_AFFINITY
+static int thread_cpus_parse(char* spec, cpu_set_t* cpus){
+	char* token = spec;
+	unsigned long first, last;
+
+	CPU_ZERO(cpus);
+	while(*token){
+		if(*token == ',' || isspace(*token)){
+			token++;
+			continue;
+		}
+
+		first = last = strtoul(token, &token, 10);
+		if(*token == '-'){
+			last = strtoul(token + 1, &token, 10);
+		}
+
+		if(last < first || last >= CPU_SETSIZE || (*token && *token != ',' && !isspace(*token))){
+			LOGPF("Invalid CPU list %s", spec);
+			return 1;
+		}
+
+		for(; first <= last; first++){
+			CPU_SET(first, cpus);
+		}
+	}
+
+	if(!CPU_COUNT(cpus)){
+		LOGPF("CPU list %s selects no CPUs", spec);
+		return 1;
+	}
+	return 0;
+}
+
+static void thread_cpus_print(cpu_set_t* cpus, char* out, size_t len){
+	size_t cpu, last, offset = 0;
+
+	out[0] = 0;
+	//print runs of consecutive CPUs as ranges
+	for(cpu = 0; cpu < CPU_SETSIZE && offset < len; cpu++){
+		if(CPU_ISSET(cpu, cpus)){
+			for(last = cpu; last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, cpus); last++){
+			}
+
+			if(last > cpu){
+				offset += snprintf(out + offset, len - offset, "%s%" PRIsize_t "-%" PRIsize_t, offset ? "," : "", cpu, last);
+			}
+			else{
+				offset += snprintf(out + offset, len - offset, "%s%" PRIsize_t, offset ? "," : "", cpu);
+			}
+			cpu = last;
+		}
+	}
+}
+#endif
+
+static char* thread_policy_name(int policy){
+	switch(policy){
+		case SCHED_FIFO:
+			return "fifo";
+		case SCHED_RR:
+			return "rr";
+		case SCHED_OTHER:
+			return "other";
+	}
+	return "unknown";
+}
+
+int threads_configure(char* option, char* value){
+	if(!strcmp(option, "thread")){
+		return thread_option(value);
+	}
+	else if(!strcmp(option, "scheduler")){
+		threads.realtime = 1;
+		if(!strcmp(value, "fifo")){
+			threads.policy = SCHED_FIFO;
+			return 0;
+		}
+		else if(!strcmp(value, "rr")){
+			threads.policy = SCHED_RR;
+			return 0;
+		}
+		else if(!strcmp(value, "other")){
+			threads.policy = SCHED_OTHER;
+			return 0;
+		}
+		LOGPF("Unknown scheduling policy %s", value);
+		return 1;
+	}
+	else if(!strcmp(option, "priority")){
+		threads.realtime = 1;
+		threads.priority = strtol(value, NULL, 10);
+		return 0;
+	}
+	else if(!strcmp(option, "memory-lock")){
+		threads.memory_lock = !strcmp(value, "on");
+		return 0;
+	}
+	else if(!strcmp(option, "affinity") || !strcmp(option, "thread-affinity")){
+		#ifdef MM_AFFINITY
+		if(!strcmp(option, "affinity")){
+			threads.affinity_set = 1;
+			return thread_cpus_parse(value, &threads.affinity);
+		}
+		threads.thread_affinity_set = 1;
+		return thread_cpus_parse(value, &threads.thread_affinity);
+		#else
+		LOGPF("Option %s is not supported on this platform", option);
+		return 1;
+		#endif
+	}
+
+	LOGPF("Unknown thread option %s", option);
+	return 1;
+}
+
+static void thread_realtime(char* name, uint8_t affinity_set, void* affinity){
+	struct sched_param param = {
+		.sched_priority = threads.priority
+	};
+	int error, policy;
+	#ifdef MM_AFFINITY
+	char cpus[256] = "all";
+	cpu_set_t granted;
+	#endif
+
+	if(!threads.realtime && !affinity_set){
+		return;
+	}
+
+	if(threads.realtime){
+		//the priority range depends on the policy, clamp to it so `priority` may be omitted
+		param.sched_priority = clamp(threads.priority, sched_get_priority_max(threads.policy), sched_get_priority_min(threads.policy));
+		error = pthread_setschedparam(pthread_self(), threads.policy, &param);
+		if(error){
+			LOGPF("Failed to set %s scheduling with priority %d for %s: %s", thread_policy_name(threads.policy), param.sched_priority, name, strerror(error));
+		}
+	}
+
+	#ifdef MM_AFFINITY
+	if(affinity_set){
+		error = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), (cpu_set_t*) affinity);
+		if(error){
+			LOGPF("Failed to set CPU affinity for %s: %s", name, strerror(error));
+		}
+	}
+	#endif
+
+	//report what the system actually granted
+	if(pthread_getschedparam(pthread_self(), &policy, &param)){
+		policy = SCHED_OTHER;
+		param.sched_priority = 0;
+	}
+
+	#ifdef MM_AFFINITY
+	if(!pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &granted)){
+		thread_cpus_print(&granted, cpus, sizeof(cpus));
+	}
+	LOGPF("Scheduling granted for %s: policy %s, priority %d, CPUs %s", name, thread_policy_name(policy), param.sched_priority, cpus);
+	#else
+	LOGPF("Scheduling granted for %s: policy %s, priority %d", name, thread_policy_name(policy), param.sched_priority);
+	#endif
+}
+
+void threads_realtime(){
+	if(threads.memory_lock){
+		if(mlockall(MCL_CURRENT | MCL_FUTURE)){
+			LOGPF("Failed to lock process memory: %s", strerror(errno));
+		}
+		else{
+			LOG("Locked process memory");
+		}
+	}
+
+	#ifdef MM_AFFINITY
+	thread_realtime("main loop", threads.affinity_set, &threads.affinity);
+	#else
+	thread_realtime("main loop", 0, NULL);
+	#endif
+}
+
+static mm_worker* thread_find(backend* b){
+	size_t u;
+	for(u = 0; u < threads.n; u++){
+		if(threads.worker[u]->backend == b){
+			return threads.worker[u];
+		}
+	}
+	return NULL;
+}
+
+static int thread_pipe(int* fds){
+	#ifdef __linux__
+	//an eventfd counter serves as both ends of the wake-up channel
+	fds[0] = fds[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(fds[0] < 0){
+		LOGPF("Failed to create wake-up descriptor: %s", strerror(errno));
+		return 1;
+	}
+	#else
+	if(pipe(fds)){
+		LOGPF("Failed to create wake-up pipe: %s", strerror(errno));
+		return 1;
+	}
+
+	if(fcntl(fds[0], F_SETFL, O_NONBLOCK) || fcntl(fds[1], F_SETFL, O_NONBLOCK)){
+		LOGPF("Failed to set wake-up pipe to non-blocking mode: %s", strerror(errno));
+		return 1;
+	}
+	#endif
+	return 0;
+}
+
+static void thread_pipe_close(int* fds){
+	if(fds[0] >= 0){
+		close(fds[0]);
+		if(fds[1] != fds[0]){
+			close(fds[1]);
+		}
+	}
+	fds[0] = fds[1] = -1;
+}
+
+static void thread_wake(int fd){
+	uint64_t count = 1;
+	//a full pipe or a saturated counter already guarantees a wake-up
+	if(write(fd, &count, sizeof(count)) < 0 && errno != EAGAIN){
+		LOGPF("Failed to wake up thread: %s", strerror(errno));
+	}
+}
+
+static void thread_wake_drain(int fd){
+	char buffer[64];
+	while(read(fd, buffer, sizeof(buffer)) > 0){
+	}
+}
+
+static void thread_async_wake(){
+	if(threads.wake[1] >= 0){
+		thread_wake(threads.wake[1]);
+	}
+}
+
+static int thread_ring_push(thread_ring* ring, instance* inst, channel* c, channel_value* v){
+	size_t head = ring->head;
+
+	if(head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= MM_THREAD_RING){
+		ring->dropped++;
+		return 1;
+	}
+
+	ring->event[head % MM_THREAD_RING].instance = inst;
+	ring->event[head % MM_THREAD_RING].channel = c;
+	ring->event[head % MM_THREAD_RING].value = *v;
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+int threads_prepare(){
+	size_t u, n;
+	backend* b = NULL;
+	instance** inst = NULL;
+	mm_worker** worker = NULL;
+
+	for(u = 0; u < threads.names; u++){
+		b = backend_match(threads.name[u]);
+		if(!b || thread_find(b)){
+			if(!b){
+				LOGPF("Backend %s is not in use, not starting a thread for it", threads.name[u]);
+			}
+			continue;
+		}
+
+		if(mm_backend_instances(b->name, &n, &inst)){
+			return 1;
+		}
+		free(inst);
+		if(!n){
+			LOGPF("Backend %s has no instances, not starting a thread for it", b->name);
+			continue;
+		}
+
+		worker = realloc(threads.worker, (threads.n + 1) * sizeof(mm_worker*));
+		if(!worker){
+			LOG("Failed to allocate memory");
+			return 1;
+		}
+		threads.worker = worker;
+
+		threads.worker[threads.n] = calloc(1, sizeof(mm_worker));
+		if(!threads.worker[threads.n]){
+			LOG("Failed to allocate memory");
+			return 1;
+		}
+		threads.worker[threads.n]->wake[0] = threads.worker[threads.n]->wake[1] = -1;
+		threads.n++;
+
+		threads.worker[threads.n - 1]->backend = b;
+		threads.worker[threads.n - 1]->poll = calloc(1, sizeof(struct pollfd));
+		threads.worker[threads.n - 1]->channel = calloc(MM_THREAD_RING, sizeof(channel*));
+		threads.worker[threads.n - 1]->value = calloc(MM_THREAD_RING, sizeof(channel_value));
+		if(!threads.worker[threads.n - 1]->poll
+				|| !threads.worker[threads.n - 1]->channel
+				|| !threads.worker[threads.n - 1]->value){
+			LOG("Failed to allocate memory");
+			return 1;
+		}
+
+		//the backends timers are executed on the worker thread
+		threads.worker[threads.n - 1]->context = timers_context();
+		if(!threads.worker[threads.n - 1]->context
+				|| thread_pipe(threads.worker[threads.n - 1]->wake)){
+			return 1;
+		}
+	}
+
+	//the main wake-up descriptor is also used for events injected via mm_channel_event_async
+	if(thread_pipe(threads.wake) || thread_async_prepare()){
+		return 1;
+	}
+
+	if(threads.n){
+		//the channel store is shared between all threads from now on
+		if(pthread_mutex_init(&threads.lock, NULL)){
+			LOG("Failed to initialize channel store lock");
+			return 1;
+		}
+		threads.locking = 1;
+	}
+	return 0;
+}
+
+static void thread_drain(mm_worker* worker){
+	thread_ring* ring = &(worker->inbound);
+	size_t tail = ring->tail, head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE), n = 0;
+	instance* inst = NULL;
+
+	//batch consecutive events for the same instance into one handle call
+	for(; tail != head; tail++){
+		if(n && ring->event[tail % MM_THREAD_RING].instance != inst){
+			if(backend_handle(inst, n, worker->channel, worker->value)){
+				LOGPF("Instance %s failed to handle output", inst->name);
+			}
+			n = 0;
+		}
+
+		inst = ring->event[tail % MM_THREAD_RING].instance;
+		worker->channel[n] = ring->event[tail % MM_THREAD_RING].channel;
+		worker->value[n] = ring->event[tail % MM_THREAD_RING].value;
+		n++;
+	}
+
+	if(n && backend_handle(inst, n, worker->channel, worker->value)){
+		LOGPF("Instance %s failed to handle output", inst->name);
+	}
+
+	__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+}
+
+static void* thread_main(void* arg){
+	mm_worker* worker = (mm_worker*) arg;
+	uint32_t timeout, interval;
+	size_t u, n;
+	char name[256];
+
+	thread_self = worker;
+	snprintf(name, sizeof(name), "worker thread of backend %s", worker->backend->name);
+	#ifdef MM_AFFINITY
+	thread_realtime(name, threads.thread_affinity_set, &threads.thread_affinity);
+	#else
+	thread_realtime(name, 0, NULL);
+	#endif
+	core_timestamp();
+
+	while(!__atomic_load_n(&worker->shutdown, __ATOMIC_ACQUIRE)){
+		//wait for data, the next timer deadline or the interval requested by the backend
+		interval = worker->backend->interval ? worker->backend->interval() : 0;
+		timeout = (interval && interval < MM_THREAD_INTERVAL) ? interval : MM_THREAD_INTERVAL;
+		timeout = min(timeout, timers_next(worker->context));
+
+		worker->poll[0].fd = worker->wake[0];
+		worker->poll[0].events = POLLIN;
+		for(u = 0; u < worker->nfds; u++){
+			worker->poll[u + 1].fd = worker->fd[u].fd;
+			worker->poll[u + 1].events = POLLIN;
+		}
+
+		if(poll(worker->poll, worker->nfds + 1, timeout) < 0 && errno != EINTR){
+			LOGPF("Worker thread for backend %s failed to poll: %s", worker->backend->name, strerror(errno));
+			break;
+		}
+
+		//update this thread's timestamp
+		core_timestamp();
+
+		if(worker->poll[0].revents){
+			thread_wake_drain(worker->wake[0]);
+		}
+
+		//snapshot signaled descriptors, the backend may modify its registrations while processing
+		for(u = 0, n = 0; u < worker->nfds; u++){
+			if(worker->fd[u].fd >= 0 && worker->poll[u + 1].revents){
+				worker->signaled[n] = worker->fd[u];
+				n++;
+			}
+		}
+
+		if(timers_process(worker->context)){
+			break;
+		}
+
+		if(backend_process(worker->backend, n, worker->signaled)){
+			LOGPF("Backend %s failed to handle input", worker->backend->name);
+			break;
+		}
+
+		thread_drain(worker);
+
+		if(worker->emitted){
+			worker->emitted = 0;
+			thread_wake(threads.wake[1]);
+		}
+	}
+
+	if(!__atomic_load_n(&worker->shutdown, __ATOMIC_ACQUIRE)){
+		__atomic_store_n(&worker->failed, 1, __ATOMIC_RELEASE);
+		thread_wake(threads.wake[1]);
+	}
+	return NULL;
+}
+
+int threads_start(){
+	size_t u;
+	int error;
+
+	for(u = 0; u < threads.n; u++){
+		error = pthread_create(&(threads.worker[u]->thread), NULL, thread_main, threads.worker[u]);
+		if(error){
+			LOGPF("Failed to start worker thread for backend %s: %s", threads.worker[u]->backend->name, strerror(error));
+			return 1;
+		}
+		threads.worker[u]->running = 1;
+		LOGPF("Started worker thread for backend %s with %" PRIsize_t " descriptors", threads.worker[u]->backend->name, threads.worker[u]->nfds);
+	}
+	return 0;
+}
+
+int threads_collect(){
+	size_t u, tail, head;
+	thread_ring* ring = NULL;
+
+	if(threads.wake[0] >= 0){
+		thread_wake_drain(threads.wake[0]);
+	}
+
+	for(u = 0; u < threads.n; u++){
+		if(__atomic_load_n(&(threads.worker[u]->failed), __ATOMIC_ACQUIRE)){
+			LOGPF("Worker thread for backend %s terminated", threads.worker[u]->backend->name);
+			return 1;
+		}
+
+		//route the events generated by the worker
+		ring = &(threads.worker[u]->outbound);
+		head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		for(tail = ring->tail; tail != head; tail++){
+			mm_channel_event(ring->event[tail % MM_THREAD_RING].channel, ring->event[tail % MM_THREAD_RING].value);
+		}
+		__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+	}
+	return 0;
+}
+
+void threads_stop(){
+	size_t u;
+
+	for(u = 0; u < threads.n; u++){
+		if(threads.worker[u]->running){
+			__atomic_store_n(&(threads.worker[u]->shutdown), 1, __ATOMIC_RELEASE);
+			thread_wake(threads.worker[u]->wake[1]);
+			pthread_join(threads.worker[u]->thread, NULL);
+			threads.worker[u]->running = 0;
+		}
+
+		if(threads.worker[u]->inbound.dropped || threads.worker[u]->outbound.dropped){
+			LOGPF("Worker thread for backend %s dropped %" PRIsize_t " inbound and %" PRIsize_t " outbound events",
+					threads.worker[u]->backend->name,
+					threads.worker[u]->inbound.dropped,
+					threads.worker[u]->outbound.dropped);
+		}
+	}
+}
+
+void threads_cleanup(){
+	size_t u, p;
+
+	for(u = 0; u < threads.n; u++){
+		for(p = 0; p < threads.worker[u]->nfds; p++){
+			if(threads.worker[u]->fd[p].fd >= 0){
+				close(threads.worker[u]->fd[p].fd);
+			}
+		}
+
+		thread_pipe_close(threads.worker[u]->wake);
+
+		free(threads.worker[u]->fd);
+		free(threads.worker[u]->signaled);
+		free(threads.worker[u]->poll);
+		free(threads.worker[u]->channel);
+		free(threads.worker[u]->value);
+		free(threads.worker[u]);
+	}
+	free(threads.worker);
+	threads.worker = NULL;
+	threads.n = 0;
+
+	thread_pipe_close(threads.wake);
+	thread_async_cleanup();
+
+	if(threads.locking){
+		pthread_mutex_destroy(&threads.lock);
+		threads.locking = 0;
+	}
+
+	for(u = 0; u < threads.names; u++){
+		free(threads.name[u]);
+	}
+	free(threads.name);
+	threads.name = NULL;
+	threads.names = 0;
+}
+
+int thread_wake_fd(){
+	return threads.wake[0];
+}
+
+int thread_managed(backend* b){
+	return threads.n && thread_find(b);
+}
+
+size_t thread_context(backend* b){
+	mm_worker* worker = threads.n ? thread_find(b) : NULL;
+	return worker ? worker->context : 0;
+}
+
+uint8_t thread_worker(){
+	return thread_self != NULL;
+}
+
+int thread_manage_fd(backend* b, int fd, int manage, void* impl){
+	mm_worker* worker = thread_find(b);
+	managed_fd* fds = NULL;
+	struct pollfd* pfd = NULL;
+	size_t u;
+
+	if(!worker){
+		return 1;
+	}
+
+	//find exact match
+	for(u = 0; u < worker->nfds; u++){
+		if(worker->fd[u].fd == fd){
+			worker->fd[u].impl = impl;
+			if(!manage){
+				worker->fd[u].fd = -1;
+				worker->fd[u].impl = NULL;
+			}
+			return 0;
+		}
+	}
+
+	if(!manage){
+		return 0;
+	}
+
+	//find free slot
+	for(u = 0; u < worker->nfds; u++){
+		if(worker->fd[u].fd < 0){
+			break;
+		}
+	}
+
+	//if necessary expand
+	if(u == worker->nfds){
+		fds = realloc(worker->fd, (worker->nfds + 1) * sizeof(managed_fd));
+		if(!fds){
+			LOG("Failed to allocate memory");
+			return 1;
+		}
+		worker->fd = fds;
+
+		fds = realloc(worker->signaled, (worker->nfds + 1) * sizeof(managed_fd));
+		if(!fds){
+			LOG("Failed to allocate memory");
+			return 1;
+		}
+		worker->signaled = fds;
+
+		pfd = realloc(worker->poll, (worker->nfds + 2) * sizeof(struct pollfd));
+		if(!pfd){
+			LOG("Failed to allocate memory");
+			return 1;
+		}
+		worker->poll = pfd;
+		worker->nfds++;
+	}
+
+	worker->fd[u].fd = fd;
+	worker->fd[u].backend = b;
+	worker->fd[u].impl = impl;
+	return 0;
+}
+
+int thread_notify(instance* inst, size_t nev, channel** c, channel_value* v){
+	mm_worker* worker = thread_find(inst->backend);
+	size_t u;
+
+	if(!worker){
+		return 1;
+	}
+
+	for(u = 0; u < nev; u++){
+		if(thread_ring_push(&(worker->inbound), inst, c[u], v + u)){
+			if(worker->inbound.dropped == 1){
+				LOGPF("Event queue for backend %s thread overflowed, dropping events", worker->backend->name);
+			}
+			worker->inbound.dropped += nev - u - 1;
+			break;
+		}
+	}
+
+	thread_wake(worker->wake[1]);
+	return 0;
+}
+
+int thread_emit(channel* c, channel_value v){
+	//stamp the event when it is generated, not when the main thread gets around to routing it
+	if(!v.timestamp){
+		v.timestamp = core_clock();
+	}
+
+	if(thread_ring_push(&(thread_self->outbound), NULL, c, &v)){
+		if(thread_self->outbound.dropped == 1){
+			LOGPF("Event queue from backend %s thread overflowed, dropping events", thread_self->backend->name);
+		}
+		return 0;
+	}
+
+	//wake the main thread early so routing can start while the backend is still processing
+	if(!thread_self->emitted){
+		thread_self->emitted = 1;
+		thread_wake(threads.wake[1]);
+	}
+	return 0;
+}
+
+void thread_lock(){
+	if(threads.locking){
+		pthread_mutex_lock(&threads.lock);
+	}
+}
+
+void thread_unlock(){
+	if(threads.locking){
+		pthread_mutex_unlock(&threads.lock);
+	}
+}
+#else
+int threads_configure(char* option, char* value){
+	LOGPF("Option %s is not supported on this platform", option);
+	return 1;
+}
+
+void threads_realtime(){
+}
+
+static void thread_async_wake(){
+	//no wake-up mechanism available, injected events are routed with the next core iteration
+}
+
+int threads_prepare(){
+	return thread_async_prepare();
+}
+
+int threads_start(){
+	return 0;
+}
+
+int threads_collect(){
+	return 0;
+}
+
+void threads_stop(){
+}
+
+void threads_cleanup(){
+	thread_async_cleanup();
+}
+
+int thread_wake_fd(){
+	return -1;
+}
+
+int thread_managed(backend* b){
+	return 0;
+}
+
+size_t thread_context(backend* b){
+	return 0;
+}
+
+uint8_t thread_worker(){
+	return 0;
+}
+
+int thread_manage_fd(backend* b, int fd, int manage, void* impl){
+	return 1;
+}
+
+int thread_notify(instance* inst, size_t nev, channel** c, channel_value* v){
+	return 1;
+}
+
+int thread_emit(channel* c, channel_value v){
+	return 1;
+}
+
+void thread_lock(){
+}
+
+void thread_unlock(){
+}
+#endif
+
+static int thread_async_prepare(){
+	size_t u;
+
+	async.event = calloc(MM_THREAD_RING, sizeof(thread_async_event));
+	if(!async.event){
+		LOG("Failed to allocate memory");
+		return 1;
+	}
+
+	//each slot carries the position it may next be claimed at
+	for(u = 0; u < MM_THREAD_RING; u++){
+		async.event[u].sequence = u;
+	}
+	async.head = async.tail = async.dropped = 0;
+	async.pending = 0;
+	return 0;
+}
+
+static void thread_async_cleanup(){
+	if(async.dropped){
+		LOGPF("Dropped %" PRIsize_t " asynchronously injected events", async.dropped);
+	}
+
+	free(async.event);
+	async.event = NULL;
+	async.dropped = 0;
+}
+
+MM_API int mm_channel_event_async(channel* c, channel_value v){
+	size_t head = __atomic_load_n(&async.head, __ATOMIC_RELAXED), sequence;
+	thread_async_event* slot = NULL;
+
+	if(!async.event){
+		return 1;
+	}
+
+	if(!v.timestamp){
+		v.timestamp = core_clock();
+	}
+
+	//claim a slot, retrying if another producer got there first
+	for(;;){
+		slot = async.event + (head % MM_THREAD_RING);
+		sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+		if(sequence == head){
+			if(__atomic_compare_exchange_n(&async.head, &head, head + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+				break;
+			}
+		}
+		else if((ssize_t) (sequence - head) < 0){
+			//the consumer has not released this slot yet, the ring is full
+			__atomic_fetch_add(&async.dropped, 1, __ATOMIC_RELAXED);
+			return 1;
+		}
+		else{
+			head = __atomic_load_n(&async.head, __ATOMIC_RELAXED);
+		}
+	}
+
+	slot->channel = c;
+	slot->value = v;
+	__atomic_store_n(&slot->sequence, head + 1, __ATOMIC_RELEASE);
+
+	//only the first event after the last collection needs to wake up the core
+	if(!__atomic_exchange_n(&async.pending, 1, __ATOMIC_SEQ_CST)){
+		thread_async_wake();
+	}
+	return 0;
+}
+
+void thread_async_collect(){
+	thread_async_event* slot = NULL;
+	size_t limit = async.tail + MM_THREAD_RING;
+
+	if(!async.event){
+		return;
+	}
+
+	//events published after this point trigger a new wake-up
+	__atomic_exchange_n(&async.pending, 0, __ATOMIC_SEQ_CST);
+
+	//collect at most one ring worth of events so fast producers can not stall the core
+	for(; async.tail != limit; async.tail++){
+		slot = async.event + (async.tail % MM_THREAD_RING);
+		if(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != async.tail + 1){
+			break;
+		}
+
+		mm_channel_event(slot->channel, slot->value);
+		__atomic_store_n(&slot->sequence, async.tail + MM_THREAD_RING, __ATOMIC_RELEASE);
+	}
+}
@@ -0,0 +1,20 @@
+/* Internal API */
+int threads_configure(char* option, char* value);
+int threads_prepare();
+int threads_start();
+void threads_realtime();
+int threads_collect();
+void threads_stop();
+void threads_cleanup();
+int thread_wake_fd();
+void thread_async_collect();
+
+/* Worker thread redirection API, used by the core when called on behalf of a backend */
+int thread_managed(backend* b);
+size_t thread_context(backend* b);
+uint8_t thread_worker();
+int thread_manage_fd(backend* b, int fd, int manage, void* impl);
+int thread_notify(instance* inst, size_t nev, channel** c, channel_value* v);
+int thread_emit(channel* c, channel_value v);
+void thread_lock();
+void thread_unlock();
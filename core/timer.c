@@ -0,0 +1,301 @@
+#include <string.h>
+#ifndef _WIN32
+	#define MM_API __attribute__((visibility ("default")))
+#else
+	#define MM_API __attribute__((dllexport))
+#endif
+
+#define BACKEND_NAME "core/tm"
+#define TIMER_DISARMED ((size_t) -1)
+#include "midimonster.h"
+#include "timer.h"
+#include "backend.h"
+#include "thread.h"
+
+/* Core-internal structures */
+typedef struct /*_mm_timer*/ {
+	backend* backend;
+	mm_timer_callback callback;
+	void* impl;
+	uint64_t deadline;
+	uint32_t interval;
+	//position within the deadline heap, TIMER_DISARMED if not scheduled
+	size_t heap;
+} mm_timer;
+
+//timers are identified by their slot index + 1, the heap stores slot indices ordered by deadline
+typedef struct /*_mm_timer_context*/ {
+	size_t n;
+	mm_timer* timer;
+	size_t pending;
+	size_t* heap;
+} timer_context;
+
+/*
+ * Every thread running backend code uses a separate timer context, which is only ever
+ * accessed from that thread. Context 0 belongs to the main thread. The context index
+ * is stored in the upper half of the timer identifier.
+ */
+static timer_context main_context = {
+	0
+};
+
+static struct {
+	size_t n;
+	timer_context** context;
+} timers = {
+	0
+};
+
+static void timer_heap_set(timer_context* ctx, size_t position, size_t slot){
+	ctx->heap[position] = slot;
+	ctx->timer[slot].heap = position;
+}
+
+static void timer_heap_up(timer_context* ctx, size_t position){
+	size_t slot = ctx->heap[position];
+
+	for(; position > 0 && ctx->timer[ctx->heap[(position - 1) / 2]].deadline > ctx->timer[slot].deadline; position = (position - 1) / 2){
+		timer_heap_set(ctx, position, ctx->heap[(position - 1) / 2]);
+	}
+	timer_heap_set(ctx, position, slot);
+}
+
+static void timer_heap_down(timer_context* ctx, size_t position){
+	size_t slot = ctx->heap[position], child;
+
+	for(child = 2 * position + 1; child < ctx->pending; child = 2 * position + 1){
+		//select the earlier child
+		if(child + 1 < ctx->pending && ctx->timer[ctx->heap[child + 1]].deadline < ctx->timer[ctx->heap[child]].deadline){
+			child++;
+		}
+
+		if(ctx->timer[ctx->heap[child]].deadline >= ctx->timer[slot].deadline){
+			break;
+		}
+
+		timer_heap_set(ctx, position, ctx->heap[child]);
+		position = child;
+	}
+	timer_heap_set(ctx, position, slot);
+}
+
+static void timer_disarm(timer_context* ctx, size_t slot){
+	size_t position = ctx->timer[slot].heap;
+
+	if(position == TIMER_DISARMED){
+		return;
+	}
+
+	ctx->timer[slot].heap = TIMER_DISARMED;
+	ctx->pending--;
+
+	//move the last heap entry into the gap and restore the heap property
+	if(position != ctx->pending){
+		timer_heap_set(ctx, position, ctx->heap[ctx->pending]);
+		if(position > 0 && ctx->timer[ctx->heap[position]].deadline < ctx->timer[ctx->heap[(position - 1) / 2]].deadline){
+			timer_heap_up(ctx, position);
+		}
+		else{
+			timer_heap_down(ctx, position);
+		}
+	}
+}
+
+static void timer_arm(timer_context* ctx, size_t slot, uint64_t deadline){
+	timer_disarm(ctx, slot);
+	ctx->timer[slot].deadline = deadline;
+	timer_heap_set(ctx, ctx->pending, slot);
+	ctx->pending++;
+	timer_heap_up(ctx, ctx->pending - 1);
+}
+
+static timer_context* timer_context_get(size_t context){
+	if(!context){
+		return &main_context;
+	}
+	return (context < timers.n) ? timers.context[context] : NULL;
+}
+
+//resolve a timer identifier to its context and slot
+static timer_context* timer_resolve(uint64_t timer, size_t* slot){
+	timer_context* ctx = timer_context_get(timer >> 32);
+	timer &= 0xFFFFFFFF;
+
+	if(!ctx || !timer || timer > ctx->n || !ctx->timer[timer - 1].callback){
+		return NULL;
+	}
+
+	*slot = timer - 1;
+	return ctx;
+}
+
+size_t timers_context(){
+	timer_context** context = NULL;
+
+	//context 0 is always the main thread
+	if(!timers.n){
+		timers.context = calloc(1, sizeof(timer_context*));
+		if(!timers.context){
+			LOG("Failed to allocate memory");
+			return 0;
+		}
+		timers.context[0] = &main_context;
+		timers.n = 1;
+	}
+
+	context = realloc(timers.context, (timers.n + 1) * sizeof(timer_context*));
+	if(!context){
+		LOG("Failed to allocate memory");
+		return 0;
+	}
+	timers.context = context;
+
+	timers.context[timers.n] = calloc(1, sizeof(timer_context));
+	if(!timers.context[timers.n]){
+		LOG("Failed to allocate memory");
+		return 0;
+	}
+	return timers.n++;
+}
+
+MM_API uint64_t mm_timer_add(char* backend_name, uint32_t delay, uint32_t interval, mm_timer_callback callback, void* impl){
+	backend* b = backend_match(backend_name);
+	size_t u, context;
+	timer_context* ctx = NULL;
+
+	if(!b || !callback){
+		LOGPF("Invalid timer registration for backend %s", backend_name);
+		return 0;
+	}
+
+	//timers run on the thread executing the backend
+	context = thread_context(b);
+	ctx = timer_context_get(context);
+	if(!ctx){
+		LOGPF("Invalid timer context for backend %s", backend_name);
+		return 0;
+	}
+
+	//find free slot
+	for(u = 0; u < ctx->n; u++){
+		if(!ctx->timer[u].callback){
+			break;
+		}
+	}
+
+	//if necessary expand
+	if(u == ctx->n){
+		ctx->timer = realloc(ctx->timer, (ctx->n + 1) * sizeof(mm_timer));
+		ctx->heap = realloc(ctx->heap, (ctx->n + 1) * sizeof(size_t));
+		if(!ctx->timer || !ctx->heap){
+			LOG("Failed to allocate memory");
+			ctx->n = ctx->pending = 0;
+			return 0;
+		}
+		ctx->n++;
+	}
+
+	ctx->timer[u].backend = b;
+	ctx->timer[u].callback = callback;
+	ctx->timer[u].impl = impl;
+	ctx->timer[u].interval = interval;
+	ctx->timer[u].heap = TIMER_DISARMED;
+	timer_arm(ctx, u, mm_timestamp() + delay);
+
+	DBGPF("Registered timer %" PRIsize_t " in context %" PRIsize_t " for backend %s, delay %" PRIu32 " interval %" PRIu32, u + 1, context, backend_name, delay, interval);
+	return (((uint64_t) context) << 32) | (u + 1);
+}
+
+MM_API int mm_timer_update(uint64_t timer, uint32_t delay){
+	size_t slot;
+	timer_context* ctx = timer_resolve(timer, &slot);
+
+	if(!ctx){
+		LOGPF("Invalid timer %" PRIu64 " updated", timer);
+		return 1;
+	}
+
+	timer_arm(ctx, slot, mm_timestamp() + delay);
+	return 0;
+}
+
+MM_API int mm_timer_cancel(uint64_t timer){
+	size_t slot;
+	timer_context* ctx = timer_resolve(timer, &slot);
+
+	if(!ctx){
+		return 1;
+	}
+
+	timer_disarm(ctx, slot);
+	ctx->timer[slot].callback = NULL;
+	return 0;
+}
+
+uint32_t timers_next(size_t context){
+	uint64_t timestamp = mm_timestamp();
+	timer_context* ctx = timer_context_get(context);
+
+	if(!ctx || !ctx->pending){
+		return UINT32_MAX;
+	}
+
+	if(ctx->timer[ctx->heap[0]].deadline <= timestamp){
+		return 0;
+	}
+
+	return min(ctx->timer[ctx->heap[0]].deadline - timestamp, UINT32_MAX);
+}
+
+int timers_process(size_t context){
+	uint64_t timestamp = mm_timestamp();
+	timer_context* ctx = timer_context_get(context);
+	size_t slot;
+
+	while(ctx && ctx->pending && ctx->timer[ctx->heap[0]].deadline <= timestamp){
+		slot = ctx->heap[0];
+
+		//reschedule before calling, the callback may update or cancel its timer
+		if(ctx->timer[slot].interval){
+			//skip missed periods instead of firing repeatedly to catch up
+			if(ctx->timer[slot].deadline + ctx->timer[slot].interval <= timestamp){
+				timer_arm(ctx, slot, timestamp + ctx->timer[slot].interval);
+			}
+			else{
+				timer_arm(ctx, slot, ctx->timer[slot].deadline + ctx->timer[slot].interval);
+			}
+		}
+		else{
+			timer_disarm(ctx, slot);
+		}
+
+		if(ctx->timer[slot].callback((((uint64_t) context) << 32) | (slot + 1), ctx->timer[slot].impl)){
+			LOGPF("Timer callback for backend %s failed", ctx->timer[slot].backend->name);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static void timers_context_free(timer_context* ctx){
+	free(ctx->timer);
+	ctx->timer = NULL;
+	free(ctx->heap);
+	ctx->heap = NULL;
+	ctx->n = ctx->pending = 0;
+}
+
+void timers_cleanup(){
+	size_t u;
+
+	for(u = 1; u < timers.n; u++){
+		timers_context_free(timers.context[u]);
+		free(timers.context[u]);
+	}
+	free(timers.context);
+	timers.context = NULL;
+	timers.n = 0;
+
+	timers_context_free(&main_context);
+}
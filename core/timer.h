@@ -0,0 +1,10 @@
+/* Internal API */
+size_t timers_context();
+int timers_process(size_t context);
+uint32_t timers_next(size_t context);
+void timers_cleanup();
+
+/* Public backend API */
+MM_API uint64_t mm_timer_add(char* backend, uint32_t delay, uint32_t interval, mm_timer_callback callback, void* impl);
+MM_API int mm_timer_update(uint64_t timer, uint32_t delay);
+MM_API int mm_timer_cancel(uint64_t timer);
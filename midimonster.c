@@ -10,6 +10,7 @@
 #define BACKEND_NAME "cli"
 #include "midimonster.h"
 #include "core/core.h"
+#include "core/log.h"
 #include "core/config.h"
 
 volatile static sig_atomic_t shutdown_requested = 0;
@@ -18,8 +19,7 @@ MM_API int log_printf(int level, char* module, char* fmt, ...){
 	int rv = 0;
 	va_list args;
 	va_start(args, fmt);
-	fprintf(stderr, "%s%s\t", level ? "debug/" : "", module);
-	rv = vfprintf(stderr, fmt, args);
+	rv = log_vprintf(level, module, fmt, args);
 	va_end(args);
 	return rv;
 }
@@ -40,9 +40,12 @@ static int usage(char* fn){
 	fprintf(stderr, "\t-v,--version  - show version\n");
 	fprintf(stderr, "\t-b <backend>  - override backend options (can be used multiple times)\n");
 	fprintf(stderr, "\t-i <instance> - override instance options (can be used multiple times)\n");
+	fprintf(stderr, "\t-c <option>   - override core options (can be used multiple times)\n");
 	fprintf(stderr, "\t-h,--help     - show this usage info\n");
 	fprintf(stderr, "\nInstance/Backend options format:\n");
 	fprintf(stderr, "<instance/backend>.<option>=<value>\n");
+	fprintf(stderr, "\nCore options format:\n");
+	fprintf(stderr, "<option>=<value>\n");
 	return EXIT_FAILURE;
 }
 
@@ -99,6 +102,16 @@ static int args_parse(int argc, char** argv, char** cfg_file){
 			}
 			u++;
 		}
+		else if(!strcmp(argv[u], "-c")){
+			if(!argv[u + 1]){
+				fprintf(stderr, "Missing core override specification\n");
+				return 1;
+			}
+			if(config_add_override(override_core, argv[u + 1])){
+				return 1;
+			}
+			u++;
+		}
 		else{
 			//if nothing else matches, it's probably the configuration file
 			*cfg_file = argv[u];
@@ -140,6 +153,12 @@ int main(int argc, char** argv){
 		goto bail;
 	}
 
+	//only validate or measure the configuration
+	if(core_load_only()){
+		rv = EXIT_SUCCESS;
+		goto bail;
+	}
+
 	signal(SIGINT, signal_handler);
 
 	//run the core loop
@@ -108,6 +108,15 @@ struct _managed_fd;
  * 		queried for use as input (to the MIDIMonster core) and/or output
  * 		(from the MIDIMonster core) channel (on a per-query basis).
  * 		Returning NULL signals an out-of-memory condition and terminates the program.
+ * 	* (optional) mmbackend_parse_channel_range
+ * 		Resolve a channel-spec containing exactly one numeric range glob
+ * 		(e.g. `{1..512}`) in one call. The spec is passed split into the text
+ * 		before the glob, the first and last value of the range and the text
+ * 		following the glob. On success, the `channels` array must be filled with
+ * 		one channel per value of the range, in range order (which may be descending).
+ * 		Returning a non-zero value makes the core fall back to resolving every
+ * 		value separately via mmbackend_parse_channel, which should then be used
+ * 		to report any errors.
  * 	* mmbackend_start
  * 		Called after all instances have been created and all mappings
  * 		have been set up. Only backends for which instances have been configured
@@ -134,6 +143,8 @@ struct _managed_fd;
  *			If not implemented, a maximum interval of one second is used.
  *			Returning 0 signals that the backend does not have a minimum
  *			interval.
+ *			Backends that need to perform work at specific points in time
+ *			should register timers with mm_timer_add instead.
  *	* mmbackend_shutdown
  *		Clean up all allocations, finalize all hardware connections. All registered
  *		backends receive the shutdown call, regardless of whether they have been
@@ -143,6 +154,7 @@ struct _managed_fd;
 typedef int (*mmbackend_handle_event)(struct _backend_instance* inst, size_t channels, struct _backend_channel** c, struct _channel_value* v);
 typedef int (*mmbackend_create_instance)(struct _backend_instance* inst);
 typedef struct _backend_channel* (*mmbackend_parse_channel)(struct _backend_instance* instance, char* spec, uint8_t flags);
+typedef int (*mmbackend_parse_channel_range)(struct _backend_instance* instance, char* prefix, uint64_t first, uint64_t last, char* suffix, uint8_t flags, struct _backend_channel** channels);
 typedef void (*mmbackend_free_channel)(struct _backend_channel* c);
 typedef int (*mmbackend_configure)(char* option, char* value);
 typedef int (*mmbackend_configure_instance)(struct _backend_instance* instance, char* option, char* value);
@@ -151,19 +163,48 @@ typedef int (*mmbackend_start)(size_t ninstances, struct _backend_instance** ins
 typedef uint32_t (*mmbackend_interval)();
 typedef int (*mmbackend_shutdown)(size_t ninstances, struct _backend_instance** inst);
 
+/*
+ * Timer callback, called with the timer identifier returned by mm_timer_add
+ * and the `impl` pointer passed at registration.
+ * Returning a non-zero value terminates the program.
+ */
+typedef int (*mm_timer_callback)(uint64_t timer, void* impl);
+
+/*
+ * Bit masks for the `flags` member of the backend structure
+ * 	* mmbackend_no_echo
+ * 		Output to a channel never causes the backend itself to generate
+ * 		input events on the same channel. Bidirectional mappings involving
+ * 		such a backend are not reported as mapping loops. Backends that can
+ * 		receive their own output (e.g. network backends sending to their own
+ * 		address or a looped-back multicast group) must not set this flag.
+ */
+typedef enum {
+	mmbackend_no_echo = 0x1
+} mmbe_backend_flags;
+
 /* Bit masks for the `flags` parameter to mmbackend_parse_channel */
 typedef enum {
 	mmchannel_input = 0x1,
 	mmchannel_output = 0x2
 } mmbe_channel_flags;
 
-/* Channel event value, .normalised is used by backends to determine channel values */
+/*
+ * Channel event value, .normalised is used by backends to determine channel values.
+ * .timestamp contains the high-resolution time (see mm_timestamp_ns) the event was
+ * generated at. Backends may set it themselves when pushing events, otherwise
+ * mm_channel_event stamps it with the current iteration time, while events from
+ * backend threads or mm_channel_event_async are stamped when they are injected.
+ * Zero-initialize the structure to have the core fill it in. Backends may use
+ * the timestamp to schedule output precisely.
+ */
 typedef struct _channel_value {
 	union {
 		double dbl;
 		uint64_t u64;
 	} raw;
 	double normalised;
+	uint64_t timestamp;
 } channel_value;
 
 /* 
@@ -182,6 +223,8 @@ typedef struct /*_mm_backend*/ {
 	mmbackend_shutdown shutdown;
 	mmbackend_free_channel channel_free;
 	mmbackend_interval interval;
+	mmbackend_parse_channel_range channel_range;
+	uint32_t flags;
 } backend;
 
 /* 
@@ -198,12 +241,15 @@ typedef struct _backend_instance {
 /* 
  * Instance channel structure
  * Backends may either manage their own channel registry or use the global
- * channel store via the mm_channel() API
+ * channel store via the mm_channel() API.
+ * The .route member is managed by the core to index the compiled routing
+ * table and should be zero-initialized and not be modified by backends.
  */
 typedef struct _backend_channel {
 	instance* instance;
 	uint64_t ident;
 	void* impl;
+	size_t route;
 } channel;
 
 /*
@@ -216,6 +262,39 @@ typedef struct _managed_fd {
 	void* impl;
 } managed_fd;
 
+/*
+ * Runtime statistics of an instance or backend, as returned by mm_stats_instance
+ * and mm_stats_backend. For instances, the call counters refer to the handle
+ * callback, for backends to the process callback. The event counters of a backend
+ * are the sums over its instances. Durations are in nanoseconds.
+ */
+typedef struct _mm_stats {
+	uint64_t events_in;
+	uint64_t events_out;
+	uint64_t calls;
+	uint64_t call_ns;
+	uint64_t call_max_ns;
+} mm_stats;
+
+/*
+ * Runtime statistics of the core, as returned by mm_stats_core.
+ * `routed` counts events enqueued to target instances (including fan-out),
+ * `swaps` the number of event collector swaps. The iteration histogram
+ * bucket n counts core iterations that took less than 2^(n + 1) microseconds
+ * from waking up to finishing the routing.
+ */
+#define MM_STATS_BUCKETS 24
+typedef struct _mm_core_stats {
+	uint64_t iterations;
+	uint64_t routed;
+	uint64_t swaps;
+	uint64_t coalesced;
+	uint64_t dropped;
+	uint64_t iteration_ns;
+	uint64_t iteration_max_ns;
+	uint64_t iteration_histogram[MM_STATS_BUCKETS];
+} mm_core_stats;
+
 /*
  * Register a new backend.
  */
@@ -226,9 +305,19 @@ MM_API int mm_backend_register(backend b);
  * Since setting an identifier for an instance is optional, this may not work
  * depending on the backend. Instance identifiers may for example be set in the
  * backends mmbackend_start call.
+ * Once all backends have been started, identifiers are indexed by the core
+ * and must not be changed anymore.
  */
 MM_API instance* mm_instance_find(char* backend, uint64_t ident);
 
+/*
+ * Same as mm_instance_find, but takes a backend handle (e.g. the `backend`
+ * member of a managed_fd or instance structure) instead of the backend name.
+ * This avoids the backend name comparison on hot paths such as per-packet
+ * instance resolution.
+ */
+MM_API instance* mm_instance_lookup(backend* b, uint64_t ident);
+
 /*
  * This function is the main interface to the core-provided channel registry.
  * This API is just a convenience function. Creating and managing a
@@ -236,6 +325,9 @@ MM_API instance* mm_instance_find(char* backend, uint64_t ident);
  * reasons).
  *
  * Channels are identified by the (instance, ident) tuple within the registry.
+ * Lookups for small identifiers (below 4096) are served from a direct-indexed
+ * per-instance array, so backends with densely numbered channels should prefer
+ * low identifiers. All other identifiers are kept in a hash table.
  *
  * This API provides a pointer to a channel structure, pre-filled with the
  * provided instance reference and identifier.
@@ -267,6 +359,8 @@ MM_API void mm_channel_update(channel* c, uint64_t ident);
  * selected on. The backend will be notified when the descriptor becomes ready
  * to read via its registered mmbackend_process_fd call. The `impl` argument
  * will be provided within the corresponding managed_fd structure upon callback.
+ * Backends should read all available data from a signaled descriptor, as the
+ * core may be configured to use edge-triggered notifications.
  */
 MM_API int mm_manage_fd(int fd, char* backend, int manage, void* impl);
 
@@ -276,6 +370,19 @@ MM_API int mm_manage_fd(int fd, char* backend, int manage, void* impl);
  */
 MM_API int mm_channel_event(channel* c, channel_value v);
 
+/*
+ * Thread-safe variant of mm_channel_event, which may be called from any thread
+ * (for example realtime callbacks of a backing library) without further locking.
+ * The event is stored in a lock-free queue and routed at the start of the next
+ * routing iteration. The core is woken up when the first event is queued, so
+ * backends do not need to register a private descriptor for that purpose.
+ * The channel must have been obtained via mm_channel beforehand, as the channel
+ * store must not be accessed from foreign threads.
+ * Returns 0 if the event was queued. If the queue is full, the event is dropped
+ * and 1 is returned.
+ */
+MM_API int mm_channel_event_async(channel* c, channel_value v);
+
 /*
  * Query all active instances for a given backend.
  * *i will need to be freed by the caller.
@@ -289,6 +396,48 @@ MM_API int mm_backend_instances(char* backend, size_t* n, instance*** i);
  */
 MM_API uint64_t mm_timestamp();
 
+/*
+ * Query the same timestamp as mm_timestamp() in microsecond or nanosecond
+ * resolution. These are read from a monotonic clock once per core iteration
+ * and are suitable for precise frame pacing and latency measurements.
+ */
+MM_API uint64_t mm_timestamp_us();
+MM_API uint64_t mm_timestamp_ns();
+
+/*
+ * Register a timer with the core. The callback is first called `delay`
+ * milliseconds from now, and then every `interval` milliseconds. Timers with
+ * an interval of 0 fire once and stay registered, so they may be re-armed
+ * with mm_timer_update. The next timer deadline directly limits the core
+ * sleep interval, so backends do not need to poll for elapsed time.
+ * Timers are run before any backend processing in each core iteration.
+ * For backends running on a worker thread, timers are run by that thread and
+ * should only be registered, updated and cancelled from backend callbacks.
+ * Returns a non-zero timer identifier on success, 0 on failure.
+ */
+MM_API uint64_t mm_timer_add(char* backend, uint32_t delay, uint32_t interval, mm_timer_callback callback, void* impl);
+
+/*
+ * (Re-)Arm a timer to fire `delay` milliseconds from now, replacing any pending
+ * deadline. Periodic timers continue with their interval from that point.
+ */
+MM_API int mm_timer_update(uint64_t timer, uint32_t delay);
+
+/*
+ * Remove a timer. The identifier may be reused by later registrations.
+ */
+MM_API int mm_timer_cancel(uint64_t timer);
+
+/*
+ * Query the runtime statistics of an instance, a backend or the core.
+ * The counters are updated without locking and may be read from any thread,
+ * though values read concurrently to an iteration may not be consistent with
+ * each other. Return 0 on success, 1 if the instance or backend is not known.
+ */
+MM_API int mm_stats_instance(char* name, mm_stats* stats);
+MM_API int mm_stats_backend(char* name, mm_stats* stats);
+MM_API void mm_stats_core(mm_core_stats* stats);
+
 /*
  * Create a channel-to-channel mapping. This API should not be used by backends.
  * It is only exported for core modules.
@@ -9,6 +9,7 @@
 
 #include "midimonster.h"
 #include "core/core.h"
+#include "core/log.h"
 #include "core/config.h"
 
 /*
@@ -43,8 +44,7 @@ MM_API int log_printf(int level, char* module, char* fmt, ...){
 	int rv = 0;
 	va_list args;
 	va_start(args, fmt);
-	fprintf(stderr, "%s%s\t", level ? "debug/" : "", module);
-	rv = vfprintf(stderr, fmt, args);
+	rv = log_vprintf(level, module, fmt, args);
 	va_end(args);
 	return rv;
 }
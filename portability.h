@@ -1,8 +1,4 @@
 #ifdef __APPLE__
-	#ifndef CLOCK_MONOTONIC_COARSE
-		#define CLOCK_MONOTONIC_COARSE _CLOCK_MONOTONIC_RAW
-	#endif
-
 	#include <libkern/OSByteOrder.h>
 	#define htobe16(x) OSSwapHostToBigInt16(x)
 	#define htole16(x) OSSwapHostToLittleInt16(x)